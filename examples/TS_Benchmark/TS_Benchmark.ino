@@ -0,0 +1,251 @@
+/*
+  TS_Benchmark.ino - A program to measure the processing time and filtering
+  accuracy of the touchscreen library, using a simulated touchscreen
+  controller.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+  Usage:
+
+  No touchscreen or display is needed: the touchscreen is simulated with
+  XPT2046_MockBus, which replays a trace of raw readings with added noise.
+  Compile, load, run, and watch the serial monitor window at 115200 bps.
+
+  The program prints the time per call, in nanoseconds, of getPoint() (which
+  reads one sample each call here), of the simulated bus alone (to subtract
+  from getPoint()), of each filter, of mapTStoDisplay() with the two-point and
+  affine calibrations and in batches, and of getTouchEvent(). It then prints,
+  for each filter, the RMS jitter of the reported position of a stationary
+  noisy touch, the percentage of samples more than 50 touchscreen units off,
+  and the percentage of untouched samples reported as touched, with fixed and
+  with adaptive pressure thresholds.
+
+  Run it before and after a change to the library, or with different settings,
+  to compare performance objectively.
+*/
+#include <Arduino.h>
+#include <TS_Display.h>
+#include <XPT2046_MockBus.h>
+#include <monitor_printf.h>
+
+// Touchscreen CS pin. It is only written, so any free pin will do.
+#define TOUCH_CS_PIN  10
+
+// Number of calls (or points, for batches) timed for each measurement, a
+// multiple of 16, and number of samples in the trace.
+#define ITERATIONS  1024
+#define TRACE_LEN   64
+
+// Position and pressure readings of the stationary touch in the trace.
+#define TRUE_X  2000
+#define TRUE_Y  1500
+#define TOUCH_Z1  400
+#define TOUCH_Z2  2300
+
+// Noise added to the X/Y readings, percent of readings that are spikes, spike
+// amplitude, and noise amplitude of untouched pressure.
+#define NOISE       8
+#define SPIKE_PCT   5
+#define SPIKE       400
+#define Z_NOISE     500
+
+// A display that draws nothing, giving TS_Display its size.
+class NullDisplay : public Adafruit_GFX {
+public:
+  NullDisplay() : Adafruit_GFX(320, 240) {}
+  void drawPixel(int16_t x, int16_t y, uint16_t color) {}
+};
+
+// Trace of raw readings: a touch for the first half, untouched after that.
+XPT2046_RawSample trace[TRACE_LEN];
+
+// Simulated controller, touchscreen, display, and touchscreen/display objects.
+XPT2046_MockBus mock(trace, TRACE_LEN);
+XPT2046_Touchscreen ts(TOUCH_CS_PIN);
+NullDisplay disp;
+TS_Display ts_display;
+
+// Names of the filters.
+const char* filterNames[] = { "best two avg", "median", "trimmed mean", "RANSAC" };
+
+// Volatile sink so timed results are not optimized away.
+volatile int32_t sink;
+
+//**************************************************************************
+// Print a time per call, given total microseconds for ITERATIONS calls.
+//**************************************************************************
+void printTime(const char* what, uint32_t us) {
+  monitor.printf("%-34s %8lu ns\n", what, (unsigned long) (us * 1000UL / ITERATIONS));
+}
+
+//**************************************************************************
+// Time the calls.
+//**************************************************************************
+void timing() {
+  monitor.printf("\nTime per call:\n");
+  uint32_t start;
+
+  ts.setSampleInterval(0);
+  mock.setNoise(NOISE, SPIKE_PCT, SPIKE, 0);
+  start = micros();
+  for (uint16_t i = 0; i < ITERATIONS; i++)
+    sink = ts.getPoint().x;
+  printTime("getPoint()", micros() - start);
+
+  start = micros();
+  for (uint16_t i = 0; i < ITERATIONS; i++) {
+    uint8_t buf[XPT2046_FRAME_BYTES(XPT2046_DEF_SAMPLES)] = { 0xB1 };
+    mock.beginTransaction();
+    mock.transfer(buf, sizeof(buf));
+    mock.endTransaction();
+    sink = buf[1];
+  }
+  printTime("  simulated bus alone", micros() - start);
+
+  const int16_t readings[7] = { 2003, 1996, 2400, 2001, 1999, 1620, 2005 };
+  for (uint8_t f = TS_FILTER_BEST_TWO_AVG; f <= TS_FILTER_RANSAC; f++)
+    for (uint8_t n = 3; n <= 7; n += 4) {
+      int16_t v[7], result = 0;
+      start = micros();
+      for (uint16_t i = 0; i < ITERATIONS; i++) {
+        memcpy(v, readings, sizeof(v));
+        TS_filter((eTS_Filter) f, v, n, &result);
+        sink = result;
+      }
+      char what[40];
+      snprintf(what, sizeof(what), "TS_filter() %s, %d", filterNames[f], n);
+      printTime(what, micros() - start);
+    }
+
+  int16_t x, y, pres;
+  start = micros();
+  for (uint16_t i = 0; i < ITERATIONS; i++) {
+    ts_display.mapTStoDisplay(1000 + i, 3000 - i, &x, &y);
+    sink = x + y;
+  }
+  printTime("mapTStoDisplay() two-point", micros() - start);
+
+  int16_t dx[3] = { 20, 300, 160 }, dy[3] = { 20, 120, 220 };
+  int16_t tx[3], ty[3];
+  for (uint8_t i = 0; i < 3; i++)
+    ts_display.mapDisplayToTS(dx[i], dy[i], &tx[i], &ty[i]);
+  TS_Affine cal;
+  ts_display.findTS_calibration(dx, dy, tx, ty, 3, &cal);
+  ts_display.setTS_calibration(cal);
+  start = micros();
+  for (uint16_t i = 0; i < ITERATIONS; i++) {
+    ts_display.mapTStoDisplay(1000 + i, 3000 - i, &x, &y);
+    sink = x + y;
+  }
+  printTime("mapTStoDisplay() affine", micros() - start);
+
+  static TS_Point pts[16];
+  static TS_DisplayPoint out[16];
+  for (uint8_t i = 0; i < 16; i++)
+    pts[i] = TS_Point(200 + 200*i, 3800 - 200*i, 500);
+  start = micros();
+  for (uint16_t i = 0; i < ITERATIONS / 16; i++) {
+    ts_display.mapTStoDisplay(pts, out, 16);
+    sink = out[i & 15].x;
+  }
+  printTime("mapTStoDisplay() batch, per point", micros() - start);
+
+  start = micros();
+  for (uint16_t i = 0; i < ITERATIONS; i++)
+    sink = ts_display.getTouchEvent(x, y, pres);
+  printTime("getTouchEvent()", micros() - start);
+}
+
+//**************************************************************************
+// Measure filtering accuracy and false touches for one filter.
+//**************************************************************************
+void accuracy(eTS_Filter filter, uint8_t samples, bool adaptive) {
+  ts.setFilter(filter, samples);
+  ts.setThresholds();
+  ts.setAdaptiveThresholds(adaptive);
+  mock.setNoise(NOISE, SPIKE_PCT, SPIKE, Z_NOISE);
+  mock.setTrace(trace, TRACE_LEN);
+
+  uint32_t touched = 0, sumSq = 0, bad = 0, untouched = 0, falseTouches = 0;
+  for (uint16_t i = 0; i < 8 * TRACE_LEN; i++) {
+    bool isTouch = mock.current()->z1 > 0;
+    TS_Point p = ts.getPoint();
+    if (isTouch) {
+      int32_t ex = p.x - TRUE_X, ey = p.y - TRUE_Y;
+      touched++;
+      sumSq += ex*ex + ey*ey;
+      if (abs(ex) > 50 || abs(ey) > 50)
+        bad++;
+    } else {
+      untouched++;
+      if (p.z > 0)
+        falseTouches++;
+    }
+  }
+  uint16_t rms10 = (uint16_t) (sqrt((float) sumSq / touched) * 10);
+  monitor.printf("%-14s %d %-8s %4d.%d %9lu%% %10lu%%\n", filterNames[filter],
+    samples, adaptive ? "adaptive" : "fixed", rms10 / 10, rms10 % 10,
+    (unsigned long) (100 * bad / touched),
+    (unsigned long) (100 * falseTouches / untouched));
+}
+
+void setup() {
+  delay(1000);
+  Serial.begin(115200);
+  while (!Serial && (millis() <= 1000));
+  delay(200);
+  monitor.begin(&Serial, 115200);
+
+  for (uint8_t i = 0; i < TRACE_LEN; i++) {
+    bool touch = i < TRACE_LEN / 2;
+    trace[i].z1 = touch ? TOUCH_Z1 : 0;
+    trace[i].z2 = touch ? TOUCH_Z2 : 4095;
+    trace[i].x = touch ? TRUE_X : 0;
+    trace[i].y = touch ? TRUE_Y : 0;
+  }
+
+  ts.begin(mock);
+  ts.setRotation(1);
+  ts_display.begin(&ts, &disp);
+
+  timing();
+
+  monitor.printf("\nAccuracy:\n"
+    "filter         n thresh   jitter    >50 off false touch\n");
+  for (uint8_t adaptive = 0; adaptive <= 1; adaptive++)
+    for (uint8_t f = TS_FILTER_BEST_TWO_AVG; f <= TS_FILTER_RANSAC; f++)
+      for (uint8_t n = 3; n <= 7; n += 4)
+        accuracy((eTS_Filter) f, n, adaptive);
+}
+
+void loop() {
+}
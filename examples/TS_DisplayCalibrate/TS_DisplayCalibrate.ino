@@ -46,12 +46,12 @@
   as done here, and use it for mapping touchscreen point coordinates to TFT
   display coordinates.
 
-  If the SAMD architecture is being used (ARDUINO_ARCH_SAMD), this stores the
-  calibration values in the microprocessor EEPROM using the library module
-  FlashStorage_SAMD. If you restart the program (without reloading it), it
-  should initialize with the last calibration values rather than the defaults.
-  When you reload the program, that erases the EEPROM so it has to start anew at
-  storing calibrated values after you do a new calibration.
+  This stores the calibration in EEPROM as a TS_Calibration record, using class
+  TS_CalStorageEEPROM (on SAMD boards, with the EEPROM emulation of library
+  module FlashStorage_SAMD). If you restart the program (without reloading it),
+  it initializes with the last calibration values rather than the defaults.
+  On SAMD, when you reload the program, that erases the EEPROM so it has to
+  start anew at storing calibrated values after you do a new calibration.
 */
 #include <Arduino.h>
 #include <stdarg.h>
@@ -61,7 +61,7 @@
 #include <Fonts/FreeSans9pt7b.h> // From Adafruit_GFX_Library
 #include <monitor_printf.h>
 
-// EEPROM support currently only if SAMD architecture.
+// SAMD boards have no EEPROM library, so use the FlashStorage_SAMD emulation.
 #ifdef ARDUINO_ARCH_SAMD
 
 // It appears (page 29 of Atmel SAM D21E / SAM D21G / SAM D21J data sheet) that
@@ -77,12 +77,10 @@
 // To be included only in one file to avoid `Multiple Definitions` Linker Error.
 #include <FlashStorage_SAMD.h>
 
-// Signature used at start of a flash memory block to mark the block as
-// containing valid data written by the application.
-const int WRITTEN_SIGNATURE = 0xBEEFDEED;
-
 #endif
 
+#include <TS_CalStorageEEPROM.h>
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 // Constants.
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -133,20 +131,6 @@ typedef enum _eState {
   STATE_WAIT_POINT_SHOW_IT  // Wait for user to tap anywhere, then draw "+" there
 } eState;
 
-/////////////////////////////////////////////////////////////////////////////////////////////
-// Structs.
-/////////////////////////////////////////////////////////////////////////////////////////////
-
-// Structure containing non-volatile data to be stored in flash memory (with
-// copy in regular memory). We use this structure even if we don't have the SAMD
-// architecture support for storing it in EEPROM.
-struct nonvolatileSettings {
-  int16_t TS_LR_X;
-  int16_t TS_LR_Y;
-  int16_t TS_UL_X;
-  int16_t TS_UL_Y;
-};
-
 /////////////////////////////////////////////////////////////////////////////////////////////
 // Variables.
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -175,9 +159,10 @@ char TFTprintfBuf[TFT_PRINTF_BUF_SIZE];
 // Current state of interaction with user.
 eState state;
 
-// The current non-volatile settings initialized from flash-based EEPROM (and
-// written back to EEPROM when the data changes).
-nonvolatileSettings NVsettings;
+// Calibration record stored in EEPROM at address 0, and the copy of it loaded
+// at startup and written back after calibration.
+TS_CalStorageEEPROM calStorage(0);
+TS_Calibration cal;
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 // Functions.
@@ -211,58 +196,15 @@ void showTS_XY(int16_t x, int16_t y, int16_t TSx, int16_t TSy) {
   tft_printf(x, y, COLOR_TEXT, "TX = %d,  TY = %d", TSx, TSy);
 }
 
-// EEPROM support currently only if SAMD architecture.
-#ifdef ARDUINO_ARCH_SAMD
-
-//**************************************************************************
-// Read non-volatile settings from flash memory into 'settings'.  If flash
-// memory has not yet been initialized, initialize it with 'defaults'.
-//**************************************************************************
-void readNonvolatileSettings(nonvolatileSettings& settings,
-    const nonvolatileSettings& defaults) {
-  // Initialize to only commit data when we call the commit function.
-  EEPROM.setCommitASAP(false);
-  // Check signature at address 0.
-  int signature;
-  uint16_t storedAddress = 0;
-  EEPROM.get(storedAddress, signature);
-  // If flash-based EEPROM is empty, write WRITTEN_SIGNATURE and defaults to it.
-  if (signature != WRITTEN_SIGNATURE) {
-    monitor.printf("EEPROM is uninitialized, writing defaults\n");
-    EEPROM.put(storedAddress, WRITTEN_SIGNATURE);
-    EEPROM.put(storedAddress + sizeof(signature), defaults);
-    EEPROM.commit();
-  }
-
-  // Read settings data from flash-based EEPROM.
-  EEPROM.get(storedAddress + sizeof(signature), settings);
-}
-
-//**************************************************************************
-// Write 'settings' to flash memory IF IT HAS CHANGED. Return true if it changed
-// and was written, else false.
-//**************************************************************************
-bool writeNonvolatileSettingsIfChanged(nonvolatileSettings& settings) {
-  int signature;
-  uint16_t storedAddress = 0;
-  nonvolatileSettings tmp;
-  EEPROM.get(storedAddress + sizeof(signature), tmp);
-  if (memcmp(&settings, &tmp, sizeof(nonvolatileSettings)) == 0)
-    return(false);
-  EEPROM.put(storedAddress + sizeof(signature), settings);
-  EEPROM.commit();
-  return(true);
-}
-
-#endif
-
 //**************************************************************************
-// Show nonvolatile settings on serial monitor.
+// Show current calibration settings on serial monitor.
 //**************************************************************************
-void showNVsettings(char* title, const nonvolatileSettings& settings) {
+void showCalibration(const char* title) {
+  int16_t TS_LR_X, TS_LR_Y, TS_UL_X, TS_UL_Y;
+  ts_display->getTS_calibration(&TS_LR_X, &TS_LR_Y, &TS_UL_X, &TS_UL_Y);
   monitor.printf("%s\n", title);
   monitor.printf(" TS_LR_X: %d  TS_LR_Y: %d  TS_UL_X: %d  TS_UL_Y: %d\n",
-    settings.TS_LR_X, settings.TS_LR_Y, settings.TS_UL_X, settings.TS_UL_Y);
+    TS_LR_X, TS_LR_Y, TS_UL_X, TS_UL_Y);
 }
 
 //**************************************************************************
@@ -292,29 +234,13 @@ void setup() {
   ts->begin();
   ts->setRotation(tft->getRotation());
 
-  // Create touchscreen-TFT object and initialize it.
+  // Create touchscreen-TFT object and initialize it, loading the calibration
+  // saved in EEPROM if there is one.
   ts_display = new TS_Display();
-  ts_display->begin(ts, tft);
-
-  // Make 'defaults' hold the default non-volatile settings when the settings
-  // are first initialized. Here, we get the initial calibration settings from
-  // ts_display.
-  nonvolatileSettings defaults;
-  ts_display->getTS_calibration(&defaults.TS_LR_X, &defaults.TS_LR_Y, &defaults.TS_UL_X,
-    &defaults.TS_UL_Y);
-  showNVsettings("Calibration setting defaults:", defaults);
-
-  // EEPROM support currently only if SAMD architecture.
-  #ifdef ARDUINO_ARCH_SAMD
-  // Read non-volatile settings from flash-based EEPROM into 'NVsettings', then
-  // set them as the current calibration settings in 'ts_display'.
-  readNonvolatileSettings(NVsettings, defaults);
-  ts_display->setTS_calibration(NVsettings.TS_LR_X, NVsettings.TS_LR_Y, NVsettings.TS_UL_X,
-    NVsettings.TS_UL_Y);
-  showNVsettings("Non-volatile EEPROM calibration settings:", NVsettings);
-  #else
-  monitor.printf("Unable to read calibration settings from EEPROM - currently this needs SAMD architecture to do that\n");
-  #endif
+  if (ts_display->begin(ts, tft, &calStorage, &cal))
+    showCalibration("Non-volatile EEPROM calibration settings:");
+  else
+    showCalibration("No calibration in EEPROM, using defaults:");
 
   // Get position of TFT upper-left and lower-right corner.
   x_ULcorner = 0;
@@ -395,21 +321,16 @@ void loop() {
     if (isTouched) {
       state = STATE_WAIT_RELEASE;
       // Map the two touchscreen points to the correct calibration values at the
-      // extreme ends of the display. Put resulting calibration parameters into
-      // NVsettings and set them as the new calibration parameters in ts_display,
-      // as well as writing them to the EEPROM.
+      // extreme ends of the display. Set the resulting calibration parameters
+      // as the new calibration parameters in ts_display, and write them to the
+      // EEPROM.
+      int16_t TS_LR_X, TS_LR_Y, TS_UL_X, TS_UL_Y;
       ts_display->findTS_calibration(x_UL, y_UL, x_LR, y_LR, TSx_UL, TSy_UL, TSx_LR,
-        TSy_LR, &NVsettings.TS_LR_X, &NVsettings.TS_LR_Y, &NVsettings.TS_UL_X,
-        &NVsettings.TS_UL_Y);
-      ts_display->setTS_calibration(NVsettings.TS_LR_X, NVsettings.TS_LR_Y,
-        NVsettings.TS_UL_X, NVsettings.TS_UL_Y);
-      // EEPROM support currently only if SAMD architecture.
-      #ifdef ARDUINO_ARCH_SAMD
-      writeNonvolatileSettingsIfChanged(NVsettings);
-      #else
-      monitor.printf("Unable to store calibration settings in EEPROM - currently this needs SAMD architecture to do that\n");
-      #endif
-      showNVsettings("Calibration results:", NVsettings);
+        TSy_LR, &TS_LR_X, &TS_LR_Y, &TS_UL_X, &TS_UL_Y);
+      ts_display->setTS_calibration(TS_LR_X, TS_LR_Y, TS_UL_X, TS_UL_Y);
+      if (!ts_display->saveCalibration(&calStorage, &cal))
+        monitor.printf("Unable to store calibration settings in EEPROM\n");
+      showCalibration("Calibration results:");
 
       // Show the display corner points calibration mapping on the display.
       ts_display->mapDisplayToTS(x_ULcorner, y_ULcorner, &TSx_ULcorner, &TSy_ULcorner);
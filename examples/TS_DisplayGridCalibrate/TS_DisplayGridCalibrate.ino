@@ -0,0 +1,221 @@
+/*
+  TS_DisplayGridCalibrate.ino - A program to illustrate affine calibration and
+  nonlinearity correction of the touchscreen using a grid of calibration points.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+  Usage:
+
+  To use this, set the _PIN #defines below for your system, compile, load, run,
+  and tap the center of each displayed + in turn. The taps are used to compute
+  an affine calibration (correcting skew and rotation of the touchscreen as well
+  as scale and offset) and a correction table for the nonlinearity of the
+  touchscreen near its edges. Both are written to the serial monitor as C++
+  code that can be copied into your project; the correction table can be
+  stored in PROGMEM. After calibration, tap anywhere to see a + drawn at the
+  mapped point.
+*/
+#include <Arduino.h>
+#include <Adafruit_ILI9341.h>
+#include <TS_Display.h>
+#include <Fonts/FreeSans9pt7b.h> // From Adafruit_GFX_Library
+#include <monitor_printf.h>
+
+// TFT display and touchscreen I/O pin definitions, using standard Arduino pin
+// numbers/IDs.
+// These values are set for my system, change them to the appropriate values for
+// your own system.
+#define TFT_CS_PIN    10
+#define TFT_DC_PIN    2
+#define TFT_LED_PIN   A2
+#define TOUCH_CS_PIN  A0
+#define TOUCH_IRQ_PIN A7
+// TOUCH_MOSI_PIN=11, TOUCH_MISO_PIN=12, TOUCH_SCK_PIN=13
+
+// Screen rotation to use. 0=north, 1=east, 2=south, 3=west; 0/2=portrait, 1/3=landscape.
+#define ROTATION 2
+
+// Number of columns and rows of calibration points.
+#define GRID_COLS 5
+#define GRID_ROWS 5
+#define GRID_POINTS (GRID_COLS*GRID_ROWS)
+
+// Length of each arm of "+" sign, and its distance from the display edges.
+#define PLUS_ARM_LEN 10
+#define PLUS_OFFSET  (PLUS_ARM_LEN+2)
+
+// Color of background, text, calibration plus signs, and test plus signs.
+#define COLOR_BKGD ILI9341_BLACK
+#define COLOR_TEXT ILI9341_YELLOW
+#define COLOR_PLUS_CALIB ILI9341_BLUE
+#define COLOR_PLUS_TEST ILI9341_GREEN
+
+// Pointer to touchscreen object.
+XPT2046_Touchscreen* ts;
+
+// Pointer to TFT LCD display object.
+Adafruit_ILI9341* tft;
+
+// Pointer to touchscreen/TFT LCD display object.
+TS_Display* ts_display;
+
+// Display coordinates of the calibration points and the touchscreen
+// coordinates tapped at them.
+int16_t x[GRID_POINTS], y[GRID_POINTS];
+int16_t TSx[GRID_POINTS], TSy[GRID_POINTS];
+
+// Index of the calibration point being waited for, GRID_POINTS when done.
+uint8_t point;
+
+// Affine calibration and correction tables computed from the taps.
+TS_Affine cal;
+TS_AxisLUT lut;
+
+//**************************************************************************
+// Draw a plus sign at a specified TFT location.
+//**************************************************************************
+void drawPlus(int16_t x, int16_t y, int16_t color, uint8_t len = PLUS_ARM_LEN) {
+  tft->drawFastVLine(x, y-len, 2*len+1, color);
+  tft->drawFastHLine(x-len, y, 2*len+1, color);
+}
+
+//**************************************************************************
+// Print one correction table to the serial monitor as a C++ initializer.
+//**************************************************************************
+void printTable(const int16_t* t) {
+  monitor.printf("  {");
+  for (uint8_t i = 0; i < TS_LUT_SIZE; i++)
+    monitor.printf("%s%d", (i == 0) ? "" : (i % 11 == 0) ? ",\n   " : ", ", t[i]);
+  monitor.printf("}");
+}
+
+//**************************************************************************
+// Compute and print the calibration from the tapped points.
+//**************************************************************************
+void calibrate() {
+  if (!ts_display->findTS_calibration(x, y, TSx, TSy, GRID_POINTS, &cal) ||
+      !ts_display->setTS_calibration(cal)) {
+    monitor.printf("Calibration failed, the taps do not span the display\n");
+    return;
+  }
+  monitor.printf("const TS_Affine cal = {%ld, %ld, %ld, %ld, %ld, %ld};\n",
+    (long) cal.a, (long) cal.b, (long) cal.c, (long) cal.d, (long) cal.e,
+    (long) cal.f);
+  if (!ts_display->findTS_correction(x, y, TSx, TSy, GRID_POINTS, &lut)) {
+    monitor.printf("Unable to compute correction tables\n");
+    return;
+  }
+  ts_display->setTS_correction(&lut);
+  monitor.printf("const TS_AxisLUT lut PROGMEM = {\n");
+  printTable(lut.x);
+  monitor.printf(",\n");
+  printTable(lut.y);
+  monitor.printf("\n};\n");
+  monitor.printf("Then call ts_display->setTS_calibration(cal) and "
+    "ts_display->setTS_correction(&lut, true)\n");
+}
+
+//**************************************************************************
+// Standard Arduino setup function.
+//**************************************************************************
+void setup() {
+  // Initialize for printfs to serial monitor.
+  monitor.begin(&Serial, 115200);
+  monitor.printf("Initializing\n");
+
+  // Create TFT display object and initialize it.
+  tft = new Adafruit_ILI9341(TFT_CS_PIN, TFT_DC_PIN);
+  pinMode(TFT_LED_PIN, OUTPUT);
+  digitalWrite(TFT_LED_PIN, LOW);
+  tft->begin();
+  tft->setRotation(ROTATION);
+  tft->setTextSize(1);
+  tft->setTextWrap(false);
+  tft->setFont(&FreeSans9pt7b);
+  tft->setTextColor(COLOR_TEXT);
+
+  // Create touchscreen object and initialize it.
+  ts = new XPT2046_Touchscreen(TOUCH_CS_PIN, TOUCH_IRQ_PIN);
+  ts->begin();
+  ts->setRotation(tft->getRotation());
+
+  // Create touchscreen-TFT object and initialize it.
+  ts_display = new TS_Display();
+  ts_display->begin(ts, tft);
+
+  // Compute the grid of calibration points, reaching close to the edges
+  // where the touchscreen is least linear.
+  uint8_t i = 0;
+  for (uint8_t r = 0; r < GRID_ROWS; r++)
+    for (uint8_t c = 0; c < GRID_COLS; c++, i++) {
+      x[i] = PLUS_OFFSET + (int32_t) c * (tft->width() - 1 - 2*PLUS_OFFSET) / (GRID_COLS-1);
+      y[i] = PLUS_OFFSET + (int32_t) r * (tft->height() - 1 - 2*PLUS_OFFSET) / (GRID_ROWS-1);
+    }
+
+  // Paint first "+" and wait for user to tap it.
+  tft->fillScreen(COLOR_BKGD);
+  point = 0;
+  drawPlus(x[point], y[point], COLOR_PLUS_CALIB);
+  monitor.printf("Tap each + in turn\n");
+}
+
+//**************************************************************************
+// Standard Arduino loop() function.
+//**************************************************************************
+void loop() {
+  int16_t dx, dy, pres, px, py;
+  eTouchEvent touchEvent = ts_display->getTouchEvent(dx, dy, pres, &px, &py);
+  if (touchEvent != TS_TOUCH_EVENT)
+    return;
+
+  if (point < GRID_POINTS) {
+    // Record the tapped touchscreen point and show the next "+".
+    TSx[point] = px;
+    TSy[point] = py;
+    monitor.printf("Point %d at (%d, %d) tapped at touchscreen (%d, %d)\n",
+      point, x[point], y[point], px, py);
+    drawPlus(x[point], y[point], COLOR_BKGD);
+    if (++point < GRID_POINTS) {
+      drawPlus(x[point], y[point], COLOR_PLUS_CALIB);
+      return;
+    }
+    calibrate();
+    tft->setCursor(10, 40);
+    tft->print("Tap to test calibration");
+    return;
+  }
+
+  // Erase screen and draw a green "+" at the tapped point.
+  tft->fillScreen(COLOR_BKGD);
+  drawPlus(dx, dy, COLOR_PLUS_TEST);
+  monitor.printf("Touch at touchscreen (%d, %d) maps to (%d, %d)\n", px, py, dx, dy);
+}
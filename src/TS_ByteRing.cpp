@@ -0,0 +1,123 @@
+/*
+  TS_ByteRing.cpp - The byte ring buffer and the varint and zigzag encoding
+  shared by the trace and stroke stream formats.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Arduino.h>
+#include <TS_ByteRing.h>
+
+/**************************************************************************/
+uint8_t* TS_putVarint(uint8_t* p, uint32_t v) {
+  while (v >= 0x80) {
+    *p++ = (uint8_t) v | 0x80;
+    v >>= 7;
+  }
+  *p++ = (uint8_t) v;
+  return(p);
+}
+
+/**************************************************************************/
+uint8_t* TS_putZigzag(uint8_t* p, int32_t d) {
+  return(TS_putVarint(p, ((uint32_t) d << 1) ^ (uint32_t) (d >> 31)));
+}
+
+/**************************************************************************/
+bool TS_ByteRing::put(const uint8_t* rec, size_t len, size_t reserve) {
+  TS_RingIndex head = _head;
+  TS_RingIndex tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+  if ((size_t)(TS_RingIndex)(head - tail) + len + reserve > (size_t)_mask + 1)
+    return(false);
+  for (size_t i = 0; i < len; i++)
+    _buf[(TS_RingIndex)(head + i) & _mask] = rec[i];
+  __atomic_store_n(&_head, (TS_RingIndex)(head + len), __ATOMIC_RELEASE);
+  return(true);
+}
+
+/**************************************************************************/
+size_t TS_ByteRing::read(uint8_t* out, size_t max) {
+  TS_RingIndex tail = _tail;
+  TS_RingIndex head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+  size_t n = (TS_RingIndex)(head - tail);
+  if (n > max)
+    n = max;
+  for (size_t i = 0; i < n; i++)
+    out[i] = _buf[(TS_RingIndex)(tail + i) & _mask];
+  __atomic_store_n(&_tail, (TS_RingIndex)(tail + n), __ATOMIC_RELEASE);
+  return(n);
+}
+
+/**************************************************************************/
+size_t TS_ByteRing::writeTo(Print& out, size_t max) {
+  TS_RingIndex tail = _tail;
+  TS_RingIndex head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+  size_t n = (TS_RingIndex)(head - tail);
+  if (n > max)
+    n = max;
+  if (n == 0)
+    return(0);
+  // The bytes up to the end of the storage, then any that wrapped around.
+  size_t start = tail & _mask;
+  size_t first = (size_t)_mask + 1 - start;
+  if (first > n)
+    first = n;
+  size_t written = out.write(&_buf[start], first);
+  if (written == first && n > first)
+    written += out.write(_buf, n - first);
+  __atomic_store_n(&_tail, (TS_RingIndex)(tail + written), __ATOMIC_RELEASE);
+  return(written);
+}
+
+/**************************************************************************/
+bool TS_VarintReader::getVarint(uint32_t* v) {
+  uint32_t value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (_pos >= _len)
+      return(false);
+    uint8_t b = _data[_pos++];
+    value |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      *v = value;
+      return(true);
+    }
+  }
+  return(false);
+}
+
+/**************************************************************************/
+bool TS_VarintReader::getDelta(int16_t* v) {
+  uint32_t u;
+  if (!getVarint(&u))
+    return(false);
+  *v = (int16_t) (*v + (int32_t)((u >> 1) ^ (0 - (u & 1))));
+  return(true);
+}
+
+// -------------------------------------------------------------------------
@@ -0,0 +1,216 @@
+/*
+  TS_ByteRing.h - Defines class TS_ByteRing, a lock-free single-producer/
+  single-consumer ring buffer of bytes, class TS_VarintReader, and the varint
+  and zigzag encoding functions shared by the XPT2046_Trace.h and TS_Stroke.h
+  stream formats. For use by those modules, not by applications.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  A varint is an unsigned value 7 bits per byte, least significant first, with
+  bit 7 set in all but the last byte. A zvarint is a signed value mapped to an
+  unsigned varint as 0, -1, 1, -2, ... (zigzag encoding).
+*/
+/**************************************************************************/
+
+#ifndef TS_ByteRing_h
+#define TS_ByteRing_h
+
+#include <Arduino.h>
+#include <TS_SampleRing.h>
+
+/**************************************************************************/
+/*!
+  @brief    Append an unsigned value as a varint.
+  @param    p   Position at which to append it, with room for 5 bytes.
+  @param    v   The value.
+  @returns  The position after it.
+*/
+/**************************************************************************/
+extern uint8_t* TS_putVarint(uint8_t* p, uint32_t v);
+
+/**************************************************************************/
+/*!
+  @brief    Append a signed value as a zvarint.
+  @param    p   Position at which to append it, with room for 5 bytes.
+  @param    d   The value.
+  @returns  The position after it.
+*/
+/**************************************************************************/
+extern uint8_t* TS_putZigzag(uint8_t* p, int32_t d);
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_ByteRing is a lock-free single-producer/single-consumer
+            ring buffer of bytes, into which the producer appends whole
+            records. It does not own its storage.
+*/
+/**************************************************************************/
+class TS_ByteRing {
+
+protected:
+
+  // Byte storage, capacity _mask+1 which is a power of two.
+  uint8_t* _buf;
+  TS_RingIndex _mask;
+
+  // Free-running head (next byte to write, written only by the producer) and
+  // tail (next byte to read, written only by the consumer) indexes.
+  TS_RingIndex _head;
+  TS_RingIndex _tail;
+
+  // Number of records dropped because the buffer was full, counted by the
+  // producer.
+  volatile uint32_t _overflows;
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  buf       Storage for capacity bytes.
+    @param  capacity  Number of bytes in buf, a power of two.
+  */
+  /**************************************************************************/
+  TS_ByteRing(uint8_t* buf, TS_RingIndex capacity) : _buf(buf),
+      _mask(capacity - 1), _head(0), _tail(0), _overflows(0) {}
+
+  /**************************************************************************/
+  /*!
+    @brief  Append a record. Called only by the producer.
+    @param  rec       The record.
+    @param  len       Number of bytes in rec.
+    @param  reserve   Number of bytes that must remain free after it.
+    @returns  true if the record was appended, false if there was not room.
+  */
+  /**************************************************************************/
+  bool put(const uint8_t* rec, size_t len, size_t reserve = 0);
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Remove up to max bytes. Called only by the consumer.
+    @param  out   Array to receive the bytes.
+    @param  max   Maximum number of bytes to remove.
+    @returns  Number of bytes removed and stored in out.
+  */
+  /**************************************************************************/
+  size_t read(uint8_t* out, size_t max);
+
+  /**************************************************************************/
+  /*!
+    @brief  Write the bytes to a stream and remove them, with at most two
+            out.write() calls and no formatting. Called only by the consumer.
+    @param  out   The stream, for example Serial or an SD card File.
+    @param  max   Maximum number of bytes to write, for example the space
+                  reported by out.availableForWrite() so as not to block.
+    @returns  Number of bytes written.
+  */
+  /**************************************************************************/
+  size_t writeTo(Print& out, size_t max = (size_t) -1);
+
+  /**************************************************************************/
+  /*!
+    @brief  Return number of bytes not yet removed.
+    @returns  Number of bytes that read() would currently return, at most.
+  */
+  /**************************************************************************/
+  size_t available() {
+    return((TS_RingIndex)(__atomic_load_n(&_head, __ATOMIC_ACQUIRE) - _tail));
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the capacity of the buffer.
+    @returns  Maximum number of bytes the buffer can hold.
+  */
+  /**************************************************************************/
+  size_t capacity() { return((size_t)_mask + 1); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return number of records dropped because the buffer was full.
+    @returns  Overflow count since construction or the last resetOverflows().
+  */
+  /**************************************************************************/
+  uint32_t overflows() {
+    #if defined(__AVR__)
+    noInterrupts();
+    uint32_t n = _overflows;
+    interrupts();
+    return(n);
+    #else
+    return(_overflows);
+    #endif
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Reset the overflow counter to 0.
+  */
+  /**************************************************************************/
+  void resetOverflows() {
+    noInterrupts();
+    _overflows = 0;
+    interrupts();
+  }
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_VarintReader decodes varints and zvarints from a block
+            of data, for the stream readers.
+*/
+/**************************************************************************/
+class TS_VarintReader {
+
+protected:
+
+  // Data, its length, and the position of the next byte to decode.
+  const uint8_t* _data;
+  size_t _len;
+  size_t _pos;
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  data  The data, which must remain in existence while it is read.
+    @param  len   Number of bytes in data.
+  */
+  /**************************************************************************/
+  TS_VarintReader(const uint8_t* data, size_t len) : _data(data), _len(len),
+      _pos(0) {}
+
+  // Decode a varint at _pos into v, or a zvarint and add it to v, advancing
+  // _pos and returning true, or returning false if the data ends first.
+  bool getVarint(uint32_t* v);
+  bool getDelta(int16_t* v);
+};
+
+#endif // TS_ByteRing_h
@@ -0,0 +1,189 @@
+/*
+  TS_CalRefiner.cpp - Refinement of the touchscreen calibration of a
+  TS_Display object from taps on buttons during normal use.
+  Released into the public domain.
+
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Arduino.h>
+#include <TS_CalRefiner.h>
+#include <TS_Calibration.h>
+
+// Touchscreen coordinate at the center of the touchscreen, also half its
+// range, used to scale coordinates to -1..1 so the fit is well conditioned.
+#define TS_MID  2048.0f
+
+#define Q16_ONE   65536L
+
+// Convert a float to Q16, rounding.
+static int32_t toQ16(float v) {
+  return((int32_t) lround(v * Q16_ONE));
+}
+
+/**************************************************************************/
+void TS_CalRefiner::begin(TS_Display* disp, float lambda, int16_t maxError) {
+  _disp = disp;
+  _lambda = lambda;
+  _maxError = maxError;
+  _taps = 0;
+  _ignored = 0;
+
+  // x = a*TSx + b*TSy + c with TSx = TS_MID*(u + 1), TSy = TS_MID*(v + 1).
+  TS_Affine m;
+  disp->currentAffine(&m);
+  float a = (float) m.a / Q16_ONE, b = (float) m.b / Q16_ONE;
+  float d = (float) m.d / Q16_ONE, e = (float) m.e / Q16_ONE;
+  _px[0] = a * TS_MID;
+  _px[1] = b * TS_MID;
+  _px[2] = (float) m.c / Q16_ONE + (a + b) * TS_MID;
+  _py[0] = d * TS_MID;
+  _py[1] = e * TS_MID;
+  _py[2] = (float) m.f / Q16_ONE + (d + e) * TS_MID;
+
+  _p[0] = _p[3] = _p[5] = TS_REFINE_P0;
+  _p[1] = _p[2] = _p[4] = 0;
+
+  // The calibration in effect is taken to be the saved one.
+  _saved = m;
+  _savedMS = millis();
+}
+
+/**************************************************************************/
+void TS_CalRefiner::fitted(TS_Affine* m) {
+  m->a = toQ16(_px[0] / TS_MID);
+  m->b = toQ16(_px[1] / TS_MID);
+  m->c = toQ16(_px[2] - _px[0] - _px[1]);
+  m->d = toQ16(_py[0] / TS_MID);
+  m->e = toQ16(_py[1] / TS_MID);
+  m->f = toQ16(_py[2] - _py[0] - _py[1]);
+}
+
+/**************************************************************************/
+bool TS_CalRefiner::addTap(int16_t x, int16_t y, int16_t TSx, int16_t TSy) {
+  if (_disp == nullptr)
+    return(false);
+
+  // The fit is to the mapping before the correction tables, so remove their
+  // correction at the tap from the position aimed at.
+  int16_t mx, my, lx, ly;
+  _disp->mapTStoDisplay(TSx, TSy, &mx, &my);
+  _disp->mapLinear(TSx, TSy, &lx, &ly);
+  float tx = x - (mx - lx);
+  float ty = y - (my - ly);
+
+  // Prediction errors of the fitted mapping at phi = (u, v, 1).
+  float u = TSx / TS_MID - 1;
+  float v = TSy / TS_MID - 1;
+  float ex = tx - (_px[0]*u + _px[1]*v + _px[2]);
+  float ey = ty - (_py[0]*u + _py[1]*v + _py[2]);
+  if (fabsf(ex) > _maxError || fabsf(ey) > _maxError) {
+    _ignored++;
+    return(false);
+  }
+
+  // Stop forgetting while any variance is at its limit, so that directions
+  // the taps don't explore don't grow without bound.
+  float lambda = _lambda;
+  if (_p[0] > TS_REFINE_P_MAX || _p[3] > TS_REFINE_P_MAX ||
+      _p[5] > TS_REFINE_P_MAX)
+    lambda = 1;
+
+  // g = P*phi, gain k = g / (lambda + phi'*g). Both axes have the same phi,
+  // so they share P and k.
+  float g0 = _p[0]*u + _p[1]*v + _p[2];
+  float g1 = _p[1]*u + _p[3]*v + _p[4];
+  float g2 = _p[2]*u + _p[4]*v + _p[5];
+  float s = lambda + u*g0 + v*g1 + g2;
+  float k0 = g0 / s, k1 = g1 / s, k2 = g2 / s;
+
+  _px[0] += k0 * ex;
+  _px[1] += k1 * ex;
+  _px[2] += k2 * ex;
+  _py[0] += k0 * ey;
+  _py[1] += k1 * ey;
+  _py[2] += k2 * ey;
+
+  // P = (P - k*g') / lambda.
+  _p[0] = (_p[0] - k0*g0) / lambda;
+  _p[1] = (_p[1] - k0*g1) / lambda;
+  _p[2] = (_p[2] - k0*g2) / lambda;
+  _p[3] = (_p[3] - k1*g1) / lambda;
+  _p[4] = (_p[4] - k1*g2) / lambda;
+  _p[5] = (_p[5] - k2*g2) / lambda;
+
+  TS_Affine m;
+  fitted(&m);
+  if (!_disp->setTS_calibration(m))
+    return(false);
+  _taps++;
+  return(true);
+}
+
+/**************************************************************************/
+bool TS_CalRefiner::saveIfDue(TS_CalStorage* storage, TS_Calibration* cal,
+    bool force) {
+  if (_disp == nullptr)
+    return(false);
+
+  // The mapping is affine, so it moves most at a corner of the touchscreen.
+  TS_Affine m;
+  _disp->currentAffine(&m);
+  float da = (float) (m.a - _saved.a) / Q16_ONE;
+  float db = (float) (m.b - _saved.b) / Q16_ONE;
+  float dc = (float) (m.c - _saved.c) / Q16_ONE;
+  float dd = (float) (m.d - _saved.d) / Q16_ONE;
+  float de = (float) (m.e - _saved.e) / Q16_ONE;
+  float df = (float) (m.f - _saved.f) / Q16_ONE;
+  float moved = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    float TSx = (i & 1) ? 4095 : 0;
+    float TSy = (i & 2) ? 4095 : 0;
+    float mx = fabsf(da*TSx + db*TSy + dc);
+    float my = fabsf(dd*TSx + de*TSy + df);
+    if (mx > moved)
+      moved = mx;
+    if (my > moved)
+      moved = my;
+  }
+
+  uint32_t now = millis();
+  if (force) {
+    if (moved == 0)
+      return(false);
+  } else if (moved < TS_REFINE_SAVE_PIXELS || now - _savedMS < TS_REFINE_SAVE_MS)
+    return(false);
+  if (!_disp->saveCalibration(storage, cal))
+    return(false);
+  _saved = m;
+  _savedMS = now;
+  return(true);
+}
+
+// -------------------------------------------------------------------------
@@ -0,0 +1,236 @@
+/*
+  TS_CalRefiner.h - Defines class TS_CalRefiner, which refines the touchscreen
+  calibration of a TS_Display object from taps on buttons during normal use.
+  Released into the public domain.
+
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  The calibration found by the calibration screen drifts over time with
+  temperature and aging of the touchscreen. A TS_CalRefiner corrects that
+  drift in the field from the taps made in normal use. Each tap on a button
+  whose center is known gives the touchscreen point at which the user touched
+  it, and the difference between the button center and the display position
+  mapped from that point is the calibration error at that point plus the
+  user's aim. Individual taps are far off-center, but the aim averages out over
+  many taps while the calibration error doesn't, so the refiner fits the
+  affine calibration (see struct TS_Affine) to the taps, using a recursive
+  least-squares (RLS) update for each one, with a fixed cost of a few dozen
+  float operations per tap and under 100 bytes of state.
+
+  The fit starts from the display's current calibration and is weighted toward
+  recent taps by a forgetting factor, so it follows slow drift. Taps more
+  than a maximum distance from the button center are taken to be aimed at
+  something else and ignored. The refined calibration is set in the TS_Display
+  object after each tap used, as an affine calibration; any correction tables
+  (see TS_Display::setTS_correction()) stay in effect, and the fit is made to
+  the mapping before their correction.
+
+  When a hit table is attached to the TS_Display object (see TS_HitTable.h),
+  taps are fed to the refiner automatically: a touch and release in the same
+  region is a tap on that region, aimed at its center, touched at the mean
+  touchscreen position of the samples of the touch. Otherwise, call addTap()
+  with the button center and touchscreen position of each tap.
+
+  The refined calibration is saved to non-volatile memory with saveIfDue(),
+  which writes a calibration record only when the mapping anywhere on the
+  touchscreen has moved by TS_REFINE_SAVE_PIXELS since the last save and at
+  most once every TS_REFINE_SAVE_MS milliseconds, to limit flash wear. Call it
+  when a write won't disturb the user interface, e.g. while the screen isn't
+  touched.
+
+  Usage:
+
+    TS_CalRefiner refiner;
+    ...
+    ts_display->begin(ts, tft, &calStorage, &cal);
+    ts_display->attachHitTable(&buttons);
+    refiner.begin(ts_display);
+    ts_display->attachRefiner(&refiner);
+    ...
+    if (!ts->touched())
+      refiner.saveIfDue(&calStorage, &cal);
+*/
+/**************************************************************************/
+
+#ifndef TS_CalRefiner_h
+#define TS_CalRefiner_h
+
+#include <Arduino.h>
+#include <TS_Display.h>
+
+struct TS_Calibration;
+class TS_CalStorage;
+
+// Default forgetting factor: the weight of each tap relative to the next one.
+// The fit remembers about 1/(1 - TS_REFINE_LAMBDA) taps.
+#ifndef TS_REFINE_LAMBDA
+#define TS_REFINE_LAMBDA  0.995f
+#endif
+
+// Default largest distance, in pixels, between a tap and the display position
+// predicted for it, for the tap to be used.
+#ifndef TS_REFINE_MAX_ERROR
+#define TS_REFINE_MAX_ERROR 20
+#endif
+
+// Initial and largest diagonal element of the RLS covariance matrix, relative
+// to the variance of the user's aim. The initial value sets how far the first
+// taps move the calibration; the limit keeps the covariance from growing
+// without bound while taps come from only a few buttons.
+#ifndef TS_REFINE_P0
+#define TS_REFINE_P0      0.05f
+#endif
+#ifndef TS_REFINE_P_MAX
+#define TS_REFINE_P_MAX   0.2f
+#endif
+
+// Smallest change in the mapping, in pixels anywhere on the touchscreen, and
+// shortest time in milliseconds since the last save, for saveIfDue() to
+// write the calibration.
+#ifndef TS_REFINE_SAVE_PIXELS
+#define TS_REFINE_SAVE_PIXELS 2
+#endif
+#ifndef TS_REFINE_SAVE_MS
+#define TS_REFINE_SAVE_MS     600000UL
+#endif
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_CalRefiner refines the calibration of a TS_Display object
+            with a recursive least-squares fit to taps on buttons.
+*/
+/**************************************************************************/
+class TS_CalRefiner {
+
+private:
+
+  // Display whose calibration is refined, nullptr before begin().
+  TS_Display* _disp;
+
+  // Forgetting factor and largest distance of a tap used.
+  float _lambda;
+  int16_t _maxError;
+
+  // Fitted mapping: display x = _px . phi and y = _py . phi, where phi is
+  // (u, v, 1) with u and v the touchscreen coordinates scaled to -1..1.
+  float _px[3], _py[3];
+
+  // Upper triangle of the symmetric RLS covariance matrix: p00, p01, p02, p11,
+  // p12, p22.
+  float _p[6];
+
+  // Numbers of taps used and ignored.
+  uint32_t _taps;
+  uint32_t _ignored;
+
+  // Mapping last saved by saveIfDue(), and millis() time of the save.
+  TS_Affine _saved;
+  uint32_t _savedMS;
+
+  // Return the fitted mapping as a TS_Affine.
+  void fitted(TS_Affine* m);
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+  */
+  /**************************************************************************/
+  TS_CalRefiner() : _disp(nullptr), _lambda(TS_REFINE_LAMBDA),
+      _maxError(TS_REFINE_MAX_ERROR), _px(), _py(), _p(), _taps(0),
+      _ignored(0), _saved(), _savedMS(0) {}
+
+  /**************************************************************************/
+  /*!
+    @brief  Start refining the calibration of a display from its current
+            calibration. Call this again after the calibration is set by other
+            means, e.g. by the calibration screen.
+    @param  disp      The display, whose begin() has been called.
+    @param  lambda    Forgetting factor, 0 < lambda <= 1. Values nearer 1 give
+                      a steadier calibration that follows drift more slowly.
+    @param  maxError  Largest distance in pixels between a tap and the display
+                      position predicted for it, for the tap to be used.
+  */
+  /**************************************************************************/
+  void begin(TS_Display* disp, float lambda = TS_REFINE_LAMBDA,
+    int16_t maxError = TS_REFINE_MAX_ERROR);
+
+  /**************************************************************************/
+  /*!
+    @brief  Refine the calibration with one tap.
+    @param  x     Display x-coordinate the tap was aimed at, e.g. the center
+                  of the button.
+    @param  y     Display y-coordinate the tap was aimed at.
+    @param  TSx   Touchscreen x-coordinate of the tap.
+    @param  TSy   Touchscreen y-coordinate of the tap.
+    @returns  true if the tap was used and the display calibration updated,
+              false if begin() has not been called or the tap was too far from
+              (x,y) and was ignored.
+  */
+  /**************************************************************************/
+  bool addTap(int16_t x, int16_t y, int16_t TSx, int16_t TSy);
+
+  /**************************************************************************/
+  /*!
+    @brief  Save the display calibration if it has changed enough since the
+            last save, and enough time has passed.
+    @param  storage   Non-volatile memory to save the calibration record in.
+    @param  cal       Pointer to record to fill and write, as for
+                      TS_Display::saveCalibration().
+    @param  force     true to save if the calibration has changed at all,
+                      regardless of the time since the last save.
+    @returns  true if the calibration was saved, false if no save was due or
+              the write failed.
+  */
+  /**************************************************************************/
+  bool saveIfDue(TS_CalStorage* storage, TS_Calibration* cal,
+    bool force = false);
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the number of taps used since begin().
+    @returns  Number of taps used.
+  */
+  /**************************************************************************/
+  uint32_t taps() { return(_taps); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the number of taps ignored since begin() because they were
+            too far from where they were aimed.
+    @returns  Number of taps ignored.
+  */
+  /**************************************************************************/
+  uint32_t ignored() { return(_ignored); }
+};
+
+#endif // TS_CalRefiner_h
@@ -0,0 +1,135 @@
+/*
+  TS_CalStorageEEPROM.h - Defines class TS_CalStorageEEPROM, which saves a
+  TS_Calibration record using the Arduino EEPROM library.
+  Released into the public domain.
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  This works with the EEPROM library of AVR and Teensy boards, and with the
+  flash-based EEPROM emulation of RP2040 and ESP32 boards. On SAMD boards,
+  which have no EEPROM library, include FlashStorage_SAMD.h (which provides a
+  compatible EEPROM object and must be included in only one file) before this
+  file.
+*/
+/**************************************************************************/
+
+#ifndef TS_CalStorageEEPROM_h
+#define TS_CalStorageEEPROM_h
+
+#include <Arduino.h>
+#if !defined(ARDUINO_ARCH_SAMD)
+#include <EEPROM.h>
+#endif
+#include <TS_Calibration.h>
+
+// Flash-based EEPROM emulations that need begin() and commit().
+#if defined(ESP32) || defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_SAMD)
+#define TS_CAL_EEPROM_COMMIT
+#endif
+
+// Size of EEPROM to reserve for the emulations that need begin().
+#ifndef TS_CAL_EEPROM_SIZE
+#define TS_CAL_EEPROM_SIZE  512
+#endif
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_CalStorageEEPROM saves a calibration record in EEPROM at a
+            given address.
+*/
+/**************************************************************************/
+class TS_CalStorageEEPROM : public TS_CalStorage {
+
+private:
+
+  // EEPROM address of the record.
+  int _address;
+
+  // Prepare the EEPROM for access.
+  void start() {
+    #if defined(ESP32) || defined(ARDUINO_ARCH_RP2040)
+    EEPROM.begin(TS_CAL_EEPROM_SIZE);
+    #elif defined(ARDUINO_ARCH_SAMD)
+    // Otherwise each write() of a byte commits a flash row.
+    EEPROM.setCommitASAP(false);
+    #endif
+  }
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  address   EEPROM address at which to save the record.
+  */
+  /**************************************************************************/
+  TS_CalStorageEEPROM(int address = 0) : _address(address) {}
+
+  /**************************************************************************/
+  /*!
+    @brief  Read data saved by write(), see TS_CalStorage.
+  */
+  /**************************************************************************/
+  bool read(void* buf, size_t len) {
+    start();
+    uint8_t* p = (uint8_t*) buf;
+    for (size_t i = 0; i < len; i++)
+      p[i] = EEPROM.read(_address + i);
+    return(true);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Write data to EEPROM, see TS_CalStorage. Only bytes that change
+            are written to the EEPROM or flash.
+  */
+  /**************************************************************************/
+  bool write(const void* buf, size_t len) {
+    start();
+    const uint8_t* p = (const uint8_t*) buf;
+    #if defined(TS_CAL_EEPROM_COMMIT)
+    // The emulations write to a RAM copy, which commit() writes to flash.
+    for (size_t i = 0; i < len; i++)
+      EEPROM.write(_address + i, p[i]);
+    #if defined(ARDUINO_ARCH_SAMD)
+    // FlashStorage_SAMD's commit() does not return a status.
+    EEPROM.commit();
+    return(true);
+    #else
+    return(EEPROM.commit());
+    #endif
+    #else
+    for (size_t i = 0; i < len; i++)
+      EEPROM.update(_address + i, p[i]);
+    return(true);
+    #endif
+  }
+};
+
+#endif // TS_CalStorageEEPROM_h
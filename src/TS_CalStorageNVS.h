@@ -0,0 +1,97 @@
+/*
+  TS_CalStorageNVS.h - Defines class TS_CalStorageNVS, which saves a
+  TS_Calibration record in ESP32 non-volatile storage (NVS).
+  Released into the public domain.
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+
+#ifndef TS_CalStorageNVS_h
+#define TS_CalStorageNVS_h
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <TS_Calibration.h>
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_CalStorageNVS saves a calibration record as a binary blob
+            under a key in an NVS namespace, using the Preferences library.
+*/
+/**************************************************************************/
+class TS_CalStorageNVS : public TS_CalStorage {
+
+private:
+
+  // NVS namespace and key of the record.
+  const char* _ns;
+  const char* _key;
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  ns    NVS namespace, at most 15 characters.
+    @param  key   Key of the record in the namespace, at most 15 characters.
+  */
+  /**************************************************************************/
+  TS_CalStorageNVS(const char* ns = "ts_cal", const char* key = "cal") :
+    _ns(ns), _key(key) {}
+
+  /**************************************************************************/
+  /*!
+    @brief  Read data saved by write(), see TS_CalStorage.
+  */
+  /**************************************************************************/
+  bool read(void* buf, size_t len) {
+    Preferences prefs;
+    if (!prefs.begin(_ns, true))
+      return(false);
+    size_t n = prefs.getBytes(_key, buf, len);
+    prefs.end();
+    return(n == len);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Write data to NVS, see TS_CalStorage.
+  */
+  /**************************************************************************/
+  bool write(const void* buf, size_t len) {
+    Preferences prefs;
+    if (!prefs.begin(_ns, false))
+      return(false);
+    size_t n = prefs.putBytes(_key, buf, len);
+    prefs.end();
+    return(n == len);
+  }
+};
+
+#endif // TS_CalStorageNVS_h
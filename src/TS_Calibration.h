@@ -0,0 +1,155 @@
+/*
+  TS_Calibration.h - Defines struct TS_Calibration, a versioned, CRC-protected
+  record of TS_Display calibration and touch settings, and class TS_CalStorage,
+  the interface to the non-volatile memory it is saved in.
+  Released into the public domain.
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  A TS_Calibration record holds everything TS_Display and XPT2046_Touchscreen
+  need to be calibrated at power-up: the two-point calibration parameters, the
+  affine calibration and its precomputed inverse, the nonlinearity correction
+  tables, the touch/release pressures and debounce time, and the touchscreen
+  pressure thresholds. It is read with a single TS_CalStorage::read() and used
+  as is, with no recomputation:
+
+    #include <TS_CalStorageEEPROM.h>
+
+    TS_CalStorageEEPROM calStorage(0);  // record at EEPROM address 0
+    TS_Calibration cal;
+    ...
+    if (!ts_display->begin(ts, tft, &calStorage, &cal))
+      ... run the calibration screen, then:
+      ts_display->saveCalibration(&calStorage, &cal);
+
+  A record is rejected if its magic number, version, size, or CRC does not
+  match, or if it was made for a different display rotation.
+
+  Storage backends are header-only so that only the one a sketch includes is
+  compiled:
+
+    TS_CalStorageEEPROM.h   Arduino EEPROM library: AVR, Teensy, RP2040 and
+                            ESP32 (flash emulation), and SAMD when the sketch
+                            includes FlashStorage_SAMD.h first.
+    TS_CalStorageNVS.h      ESP32 NVS, using the Preferences library.
+
+  Other non-volatile memories can be used by deriving a class from
+  TS_CalStorage.
+*/
+/**************************************************************************/
+
+#ifndef TS_Calibration_h
+#define TS_Calibration_h
+
+#include <Arduino.h>
+#include <TS_Display.h>
+
+// Magic number and version identifying a TS_Calibration record. The version
+// changes whenever the layout of the record changes.
+#define TS_CAL_MAGIC    0x5443
+#define TS_CAL_VERSION  1
+
+// TS_Calibration flags.
+#define TS_CAL_AFFINE   0x01  // The affine calibration is used.
+#define TS_CAL_LUT      0x02  // The correction tables are used.
+
+/**************************************************************************/
+/*!
+  @brief    Struct TS_Calibration is the record saved in non-volatile memory
+            by TS_Display::saveCalibration() and loaded by TS_Display::begin().
+*/
+/**************************************************************************/
+struct TS_Calibration {
+  uint16_t magic;           // TS_CAL_MAGIC
+  uint8_t version;          // TS_CAL_VERSION
+  uint8_t rotation;         // Display rotation the calibration was made for
+  uint16_t size;            // sizeof(TS_Calibration)
+  uint8_t flags;            // TS_CAL_ flags
+  uint8_t reserved;
+
+  // TS_Display two-point calibration parameters.
+  int16_t TS_UL_X, TS_UL_Y, TS_LR_X, TS_LR_Y;
+
+  // TS_Display touch/release event parameters.
+  uint32_t debounceMS_TR;
+  int16_t minTouchPres, maxReleasePres;
+
+  // XPT2046_Touchscreen pressure thresholds.
+  int16_t Z_Threshold, Z_Threshold_Int;
+
+  // Affine calibration and its inverse, valid if TS_CAL_AFFINE is set.
+  TS_Affine affine, affineInv;
+
+  // Correction tables, valid if TS_CAL_LUT is set.
+  TS_AxisLUT lut;
+
+  // CRC-16/CCITT of all the bytes above.
+  uint16_t crc;
+};
+
+/**************************************************************************/
+/*!
+  @brief    Compute the CRC of a calibration record.
+  @param    cal   The record.
+  @returns  CRC-16/CCITT of the record up to but not including its crc member.
+*/
+/**************************************************************************/
+extern uint16_t TS_calibrationCRC(const TS_Calibration* cal);
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_CalStorage is the interface to the non-volatile memory in
+            which a calibration record is saved.
+*/
+/**************************************************************************/
+class TS_CalStorage {
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Read data saved by write().
+    @param  buf   Buffer to receive len bytes.
+    @param  len   Number of bytes to read.
+    @returns  true if successful, false if nothing could be read.
+  */
+  /**************************************************************************/
+  virtual bool read(void* buf, size_t len) = 0;
+
+  /**************************************************************************/
+  /*!
+    @brief  Write data to non-volatile memory.
+    @param  buf   Data to write.
+    @param  len   Number of bytes to write.
+    @returns  true if successful, else false.
+  */
+  /**************************************************************************/
+  virtual bool write(const void* buf, size_t len) = 0;
+};
+
+#endif // TS_Calibration_h
@@ -34,26 +34,82 @@
 */
 #include <Arduino.h>
 #include <TS_Display.h>
+#include <TS_Calibration.h>
+#include <TS_SampleRing.h>
+#include <TS_HitTable.h>
+#include <TS_CalRefiner.h>
 
-// The four TS_ constants below are used to set the initial default calibration
-// parameter values to reasonable values probably suitable for most touchscreens.
-// The screen rotation is taken into account when using the values below to
-// initialize the mapping parameter values. In rotation mode 2 the values below
-// can be directly assigned to the calibration parameters, but in the other
-// rotation modes an offset must be applied.
-//
-// In the constant names, "SHORT" refers to either x- or y- coordinate,
-// depending on which direction is shorter in size for the current rotation,
-// and "LONG" refers to the opposite direction that is longer in size.
-#define TS_UL_SHORT  3800
-#define TS_UL_LONG   3700
-#define TS_LR_SHORT  275
-#define TS_LR_LONG   165
-
-// Value used to "flip" touchscreen coordinates. This value is used within the
-// original touchscreen code, and it is required here in order to properly
-// adjust the mapping parameter values in rotation modes 0 and 1.
-#define TS_OFFSET 4095
+// One in Q16 fixed point, and one half for rounding.
+#define Q16_ONE   65536L
+#define Q16_HALF  32768L
+
+// Round a float to Q16.
+static int32_t toQ16(float v) {
+  return((int32_t) lround(v * Q16_ONE));
+}
+
+// Apply a Q16 affine mapping to (u,v), rounding to nearest.
+static inline void affineMap(const TS_Affine& m, int16_t u, int16_t v,
+    int16_t* x, int16_t* y) {
+  *x = (int16_t) ((m.a*u + m.b*v + m.c + Q16_HALF) >> 16);
+  *y = (int16_t) ((m.d*u + m.e*v + m.f + Q16_HALF) >> 16);
+}
+
+#if defined(__ARM_FEATURE_DSP)
+// Dual signed 16-bit multiply with 32-bit accumulate: lo(x)*lo(y) +
+// hi(x)*hi(y) + acc.
+static inline int32_t smlad(uint32_t x, uint32_t y, int32_t acc) {
+  int32_t r;
+  __asm__ ("smlad %0, %1, %2, %3" : "=r" (r) : "r" (x), "r" (y), "r" (acc));
+  return(r);
+}
+
+// Pack two 16-bit values into one word, lo in the bottom half.
+static inline uint32_t pkhbt(int16_t lo, int16_t hi) {
+  uint32_t r;
+  __asm__ ("pkhbt %0, %1, %2, lsl #16" : "=r" (r) :
+    "r" ((uint32_t) (uint16_t) lo), "r" ((uint32_t) hi));
+  return(r);
+}
+#endif
+
+// Affine mapping hoisted out of a batch mapping loop. With the ARM DSP
+// extension, the linear coefficients are also kept packed in pairs when they
+// fit in 16 bits, and the rounding constant is folded into the offsets.
+struct BatchMap {
+  TS_Affine m;
+#if defined(__ARM_FEATURE_DSP)
+  bool packed;
+  uint32_t ab, de;
+  int32_t c, f;
+#endif
+
+  BatchMap(const TS_Affine& cal) : m(cal) {
+#if defined(__ARM_FEATURE_DSP)
+    packed = fits16(m.a) && fits16(m.b) && fits16(m.d) && fits16(m.e);
+    ab = pkhbt((int16_t) m.a, (int16_t) m.b);
+    de = pkhbt((int16_t) m.d, (int16_t) m.e);
+    c = m.c + Q16_HALF;
+    f = m.f + Q16_HALF;
+#endif
+  }
+
+#if defined(__ARM_FEATURE_DSP)
+  static bool fits16(int32_t v) { return(v >= -32768 && v <= 32767); }
+#endif
+
+  inline void apply(int16_t u, int16_t v, int16_t* x, int16_t* y) const {
+#if defined(__ARM_FEATURE_DSP)
+    if (packed) {
+      uint32_t uv = pkhbt(u, v);
+      *x = (int16_t) (smlad(ab, uv, c) >> 16);
+      *y = (int16_t) (smlad(de, uv, f) >> 16);
+      return;
+    }
+#endif
+    affineMap(m, u, v, x, y);
+  }
+};
 
 /**************************************************************************/
 void TS_Display::begin(XPT2046_Touchscreen* ts, Adafruit_GFX* disp) {
@@ -96,6 +152,8 @@ void TS_Display::begin(XPT2046_Touchscreen* ts, Adafruit_GFX* disp) {
   _minTouchPres = DEF_MIN_TOUCH_PRES;
   _maxReleasePres = DEF_MAX_RELEASE_PRES;
 
+  _useAffine = false;
+
   _lastEventWasTouch = false;
   _msTime = millis();
 
@@ -103,12 +161,93 @@ void TS_Display::begin(XPT2046_Touchscreen* ts, Adafruit_GFX* disp) {
   _pixelsY = _disp->height();
 }
 
+/**************************************************************************/
+bool TS_Display::begin(XPT2046_Touchscreen* ts, Adafruit_GFX* disp,
+    TS_CalStorage* storage, TS_Calibration* cal) {
+  begin(ts, disp);
+  if (!storage->read(cal, sizeof(TS_Calibration)))
+    return(false);
+  return(setCalibration(cal));
+}
+
+/**************************************************************************/
+void TS_Display::getCalibration(TS_Calibration* cal) {
+  // The record is built separately and copied out at the end, because the
+  // correction table in use may be the one in *cal itself.
+  TS_Calibration c;
+  memset(&c, 0, sizeof(TS_Calibration));
+  c.magic = TS_CAL_MAGIC;
+  c.version = TS_CAL_VERSION;
+  c.rotation = _disp->getRotation();
+  c.size = sizeof(TS_Calibration);
+  c.TS_UL_X = _TS_UL_X;
+  c.TS_UL_Y = _TS_UL_Y;
+  c.TS_LR_X = _TS_LR_X;
+  c.TS_LR_Y = _TS_LR_Y;
+  c.debounceMS_TR = _debounceMS_TR;
+  c.minTouchPres = _minTouchPres;
+  c.maxReleasePres = _maxReleasePres;
+  c.Z_Threshold = _ts->Zthreshold();
+  c.Z_Threshold_Int = _ts->Zthreshold_Int();
+  if (_useAffine) {
+    c.flags |= TS_CAL_AFFINE;
+    c.affine = _affine;
+    c.affineInv = _affineInv;
+  }
+  if (_lut != nullptr) {
+    c.flags |= TS_CAL_LUT;
+    for (uint8_t i = 0; i < TS_LUT_SIZE; i++) {
+      if (_lutProgmem) {
+        c.lut.x[i] = (int16_t) pgm_read_word(&_lut->x[i]);
+        c.lut.y[i] = (int16_t) pgm_read_word(&_lut->y[i]);
+      } else {
+        c.lut.x[i] = _lut->x[i];
+        c.lut.y[i] = _lut->y[i];
+      }
+    }
+  }
+  c.crc = TS_calibrationCRC(&c);
+  *cal = c;
+}
+
+/**************************************************************************/
+bool TS_Display::setCalibration(const TS_Calibration* cal) {
+  if (cal->magic != TS_CAL_MAGIC || cal->version != TS_CAL_VERSION ||
+      cal->size != sizeof(TS_Calibration) ||
+      cal->crc != TS_calibrationCRC(cal) ||
+      cal->rotation != _disp->getRotation())
+    return(false);
+  _TS_UL_X = cal->TS_UL_X;
+  _TS_UL_Y = cal->TS_UL_Y;
+  _TS_LR_X = cal->TS_LR_X;
+  _TS_LR_Y = cal->TS_LR_Y;
+  _debounceMS_TR = cal->debounceMS_TR;
+  _minTouchPres = cal->minTouchPres;
+  _maxReleasePres = cal->maxReleasePres;
+  _ts->setThresholds(cal->Z_Threshold, cal->Z_Threshold_Int);
+  _useAffine = (cal->flags & TS_CAL_AFFINE) != 0;
+  if (_useAffine) {
+    _affine = cal->affine;
+    _affineInv = cal->affineInv;
+  }
+  setTS_correction((cal->flags & TS_CAL_LUT) ? &cal->lut : nullptr);
+  return(true);
+}
+
+/**************************************************************************/
+bool TS_Display::saveCalibration(TS_CalStorage* storage, TS_Calibration* cal) {
+  getCalibration(cal);
+  return(storage->write(cal, sizeof(TS_Calibration)));
+}
+
 /**************************************************************************/
 eTouchEvent TS_Display::getTouchEvent(int16_t& x, int16_t& y, int16_t& pres,
     int16_t* px, int16_t* py) {
 
   eTouchEvent ret = TS_UNCERTAIN;
   TS_Point p = _ts->getPoint();
+  if (_busPeriodUs)
+    busSampled(micros());
 
   if (px != nullptr)
     *px = p.x;
@@ -122,37 +261,472 @@ eTouchEvent TS_Display::getTouchEvent(int16_t& x, int16_t& y, int16_t& pres,
   if (pres >= _minTouchPres) {
     currentTSeventIsTouch = true;
     ret = TS_TOUCH_PRESENT;
+    _touchX = x;
+    _touchY = y;
+    tapSample(p);
+    if (_predict)
+      predictSample(x, y, _ts->sampleTime());
   } else if (pres <= _maxReleasePres) {
     currentTSeventIsTouch = false;
     ret = TS_NO_TOUCH;
+    _predValid = false;
   }
 
   // If no change from last detected event, restart debounce timer.
+  uint32_t now = millis();
   if (_lastEventWasTouch == currentTSeventIsTouch) {
-    _msTime = millis();
+    _msTime = now;
     return(ret);
   }
 
   // A change since the last event has occurred, don't register it until debounce timer has expired.
-  if (millis() - _msTime < _debounceMS_TR)
+  if (now - _msTime < _debounceMS_TR)
     return(ret);
 
   // Event occurred and debounce time expired.  Restart debounce timer for timing the opposite event.
-  _msTime = millis();
+  _msTime = now;
   _lastEventWasTouch = currentTSeventIsTouch;
+  _hitRegion = hitTest(_touchX, _touchY);
+  tapEvent(currentTSeventIsTouch, _hitRegion);
   return(currentTSeventIsTouch ? TS_TOUCH_EVENT : TS_RELEASE_EVENT);
 }
 
 /**************************************************************************/
-void TS_Display::mapTStoDisplay(int16_t TSx, int16_t TSy, int16_t* x,
-    int16_t* y) {
+void TS_Display::attachHitTable(TS_HitTable* table) {
+  _hitTable = table;
+  _hitRegion = TS_NO_REGION;
+  if (_hitTable != nullptr)
+    _hitTable->build(_pixelsX, _pixelsY);
+}
+
+/**************************************************************************/
+uint8_t TS_Display::hitTest(int16_t x, int16_t y) {
+  return((_hitTable == nullptr) ? TS_NO_REGION : _hitTable->hit(x, y));
+}
+
+/**************************************************************************/
+void TS_Display::tapSample(const TS_Point& p) {
+  if (_refiner == nullptr || _tapCount == 0xFFFF)
+    return;
+  _tapSumX += p.x;
+  _tapSumY += p.y;
+  _tapCount++;
+}
+
+/**************************************************************************/
+void TS_Display::tapEvent(bool touch, uint8_t region) {
+  if (_refiner == nullptr)
+    return;
+  if (touch) {
+    _tapRegion = region;
+    return;
+  }
+
+  // A release in the region touched completes a tap at the mean touchscreen
+  // position of the touch, aimed at the center of the region there.
+  if (region != TS_NO_REGION && region == _tapRegion && _tapCount > 0) {
+    int16_t TSx = (int16_t) (_tapSumX / _tapCount);
+    int16_t TSy = (int16_t) (_tapSumY / _tapCount);
+    int16_t x, y;
+    mapTStoDisplay(TSx, TSy, &x, &y);
+    const TS_HitRegion* r = _hitTable->find(x, y);
+    if (r != nullptr && r->id == region)
+      _refiner->addTap(r->x + r->w/2, r->y + r->h/2, TSx, TSy);
+  }
+  _tapRegion = TS_NO_REGION;
+  _tapSumX = _tapSumY = 0;
+  _tapCount = 0;
+}
+
+/**************************************************************************/
+void TS_Display::attachEventQueue(TS_Event* buf, uint8_t capacity) {
+  _events = (capacity == 0) ? nullptr : buf;
+  _eventCap = (_events == nullptr) ? 0 : capacity;
+  _eventHead = 0;
+  _eventCount = 0;
+  _evTouch = false;
+  _evPending = false;
+}
+
+/**************************************************************************/
+void TS_Display::pushEvent(eTouchEvent type, const TS_Point& p, uint32_t us) {
+  TS_Event* ev;
+  uint8_t last = (_eventHead + _eventCount - 1) % _eventCap;
+  if (type == TS_MOVE_EVENT && _eventCount > 0 &&
+      _events[last].type == TS_MOVE_EVENT)
+    ev = &_events[last];
+  else if (_eventCount == _eventCap) {
+    _eventOverflows++;
+    return;
+  } else {
+    ev = &_events[(_eventHead + _eventCount) % _eventCap];
+    _eventCount++;
+  }
+  mapTStoDisplay(p.x, p.y, &ev->x, &ev->y);
+  ev->type = type;
+  ev->TSx = p.x;
+  ev->TSy = p.y;
+  ev->pres = (type == TS_RELEASE_EVENT) ? 0 : p.z;
+  ev->us = us;
+  if (type != TS_RELEASE_EVENT) {
+    _evX = ev->x;
+    _evY = ev->y;
+  }
+  ev->region = hitTest(_evX, _evY);
+  if (type != TS_MOVE_EVENT)
+    tapEvent(type == TS_TOUCH_EVENT, ev->region);
+}
+
+/**************************************************************************/
+void TS_Display::eventSample(const TS_Point& p, uint32_t us,
+    uint32_t sampleUs) {
+  bool touch = _evTouch;
+  if (p.z >= _minTouchPres) {
+    touch = true;
+    tapSample(p);
+    if (_predict) {
+      int16_t x, y;
+      mapTStoDisplay(p.x, p.y, &x, &y);
+      predictSample(x, y, sampleUs);
+    }
+  } else if (p.z <= _maxReleasePres) {
+    touch = false;
+    _predValid = false;
+  }
+
+  // No change from the last event: cancel any change being debounced, and
+  // report movement of a touch.
+  if (touch == _evTouch) {
+    _evPending = false;
+    if (_evTouch) {
+      int16_t x, y;
+      mapTStoDisplay(p.x, p.y, &x, &y);
+      if (abs(x - _evX) >= TS_MOVE_MIN_PIXELS ||
+          abs(y - _evY) >= TS_MOVE_MIN_PIXELS)
+        pushEvent(TS_MOVE_EVENT, p, us);
+    }
+    return;
+  }
+
+  // A change has occurred, register it once it has lasted the debounce time.
+  if (!_evPending) {
+    _evPending = true;
+    _evSince = us;
+    _evSincePoint = p;
+  }
+  if (us - _evSince >= _debounceMS_TR * 1000) {
+    _evPending = false;
+    _evTouch = touch;
+    pushEvent(touch ? TS_TOUCH_EVENT : TS_RELEASE_EVENT, _evSincePoint, _evSince);
+  }
+}
+
+/**************************************************************************/
+bool TS_Display::pollEvent(TS_Event& ev) {
+  if (_events == nullptr)
+    return(false);
+
+  // The time is taken after the queue is read, so it is not before any of the
+  // queued samples.
+  uint32_t now;
+  if (_ts->sampleQueue() != nullptr) {
+    TS_Sample buf[8];
+    size_t n;
+    while ((n = _ts->readSamples(buf, 8)) > 0)
+      for (size_t i = 0; i < n; i++)
+        eventSample(buf[i].p, buf[i].us, buf[i].us);
+    now = micros();
+  } else {
+    now = micros();
+    eventSample(_ts->getPoint(), now, _ts->sampleTime());
+  }
+  if (_busPeriodUs)
+    busSampled(now);
+
+  // A release produces no more samples, so complete its debounce here.
+  if (_evPending && _evTouch && now - _evSince >= _debounceMS_TR * 1000) {
+    _evPending = false;
+    _evTouch = false;
+    pushEvent(TS_RELEASE_EVENT, _evSincePoint, _evSince);
+  }
+
+  if (_eventCount == 0)
+    return(false);
+  ev = _events[_eventHead];
+  _eventHead = (_eventHead + 1) % _eventCap;
+  _eventCount--;
+  return(true);
+}
+
+/**************************************************************************/
+void TS_Display::setPredictor(bool enable, uint8_t alpha, uint8_t beta) {
+  _predict = enable;
+  _predAlpha = alpha;
+  _predBeta = beta;
+  _predValid = false;
+}
+
+/**************************************************************************/
+// Velocities are limited to this, in 1/256 pixel per ms (16 pixels/ms), which
+// keeps the fixed-point products in range.
+#define PREDICT_MAX_VEL  ((int32_t) 16 << 8)
+
+void TS_Display::predictAxis(int32_t* pos, int32_t* vel, int16_t meas,
+    uint32_t dt) {
+  int32_t pred = *pos + (*vel * (int32_t) dt) / 1000;
+  int32_t r = ((int32_t) meas << 8) - pred;
+  *pos = pred + ((r * _predAlpha) >> 8);
+  if (dt < TS_PREDICT_MIN_DT_US)
+    dt = TS_PREDICT_MIN_DT_US;
+  int32_t v = *vel + ((r * _predBeta) >> 8) * 1000 / (int32_t) dt;
+  *vel = constrain(v, -PREDICT_MAX_VEL, PREDICT_MAX_VEL);
+}
+
+/**************************************************************************/
+void TS_Display::predictSample(int16_t x, int16_t y, uint32_t us) {
+  uint32_t dt = us - _predUs;
+  if (!_predValid || dt > TS_PREDICT_MAX_GAP_MS * 1000UL) {
+    _predX = (int32_t) x << 8;
+    _predY = (int32_t) y << 8;
+    _predVx = _predVy = 0;
+    _predUs = us;
+    _predValid = true;
+    return;
+  }
+  if (dt == 0)
+    return;
+  predictAxis(&_predX, &_predVx, x, dt);
+  predictAxis(&_predY, &_predVy, y, dt);
+  _predUs = us;
+}
+
+/**************************************************************************/
+bool TS_Display::predictPoint(uint32_t msAhead, int16_t* x, int16_t* y) {
+  if (!_predict || !_predValid)
+    return(false);
+  uint32_t ahead = (micros() - _predUs) / 1000 + msAhead;
+  if (ahead > TS_PREDICT_MAX_AHEAD_MS)
+    ahead = TS_PREDICT_MAX_AHEAD_MS;
+  int32_t px = (_predX + _predVx * (int32_t) ahead + 128) >> 8;
+  int32_t py = (_predY + _predVy * (int32_t) ahead + 128) >> 8;
+  *x = (int16_t) constrain(px, (int32_t) 0, (int32_t) _pixelsX - 1);
+  *y = (int16_t) constrain(py, (int32_t) 0, (int32_t) _pixelsY - 1);
+  return(true);
+}
+
+/**************************************************************************/
+void TS_Display::setBusSchedule(uint32_t periodUs) {
+  _busPeriodUs = periodUs;
+  resetBusStats();
+}
+
+/**************************************************************************/
+void TS_Display::busSampled(uint32_t now) {
+  if (_busPeriodUs == 0)
+    return;
+  if (_busStarted) {
+    uint32_t gap = now - _busLastUs;
+    if (gap > _busMaxGapUs)
+      _busMaxGapUs = gap;
+    // Each sample is due one period after the last, and missed if a whole
+    // further period passes.
+    if (gap >= 2 * _busPeriodUs)
+      _busMisses += gap / _busPeriodUs - 1;
+  }
+  _busStarted = true;
+  _busLastUs = now;
+}
+
+/**************************************************************************/
+bool TS_Display::busSlot() {
+  if (_busPeriodUs == 0 || _ts == nullptr)
+    return(false);
+  uint32_t now = micros();
+  if (_busStarted && now - _busLastUs < _busPeriodUs)
+    return(false);
+  TS_Point p = _ts->getPoint();
+  if (_events != nullptr && _ts->sampleQueue() == nullptr)
+    eventSample(p, now, _ts->sampleTime());
+  busSampled(now);
+  return(true);
+}
+
+/**************************************************************************/
+int16_t TS_Display::busRows(int16_t w, int16_t h) {
+  busSlot();
+  uint32_t elapsed = micros() - _busLastUs;
+  uint32_t left = (elapsed < _busPeriodUs) ? _busPeriodUs - elapsed : 0;
+  uint32_t rowUs = ((uint32_t) w * _busNsPerPixel + 999) / 1000;
+  uint32_t rows = left / rowUs;
+  if (rows < 1)
+    rows = 1;
+  return((rows < (uint32_t) h) ? (int16_t) rows : h);
+}
+
+/**************************************************************************/
+// Chunks with fewer pixels than this are not timed, as micros() is too coarse.
+#define BUS_MIN_TIMED_PIXELS  256
+
+void TS_Display::busDrawn(uint32_t t0, int32_t pixels) {
+  uint32_t us = micros() - t0;
+  if (pixels < BUS_MIN_TIMED_PIXELS || us > 4000000UL)
+    return;
+  int32_t ns = (int32_t) (us * 1000 / (uint32_t) pixels);
+  int32_t est = (int32_t) _busNsPerPixel;
+  est += (ns - est) / 4;
+  _busNsPerPixel = (est < 1) ? 1 : (uint32_t) est;
+}
+
+/**************************************************************************/
+void TS_Display::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+    uint16_t color) {
+  if (_busPeriodUs == 0 || w <= 0) {
+    _disp->fillRect(x, y, w, h, color);
+    return;
+  }
+  while (h > 0) {
+    int16_t rows = busRows(w, h);
+    uint32_t t0 = micros();
+    _disp->fillRect(x, y, w, rows, color);
+    busDrawn(t0, (int32_t) w * rows);
+    y += rows;
+    h -= rows;
+  }
+  busSlot();
+}
+
+/**************************************************************************/
+void TS_Display::drawRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap,
+    int16_t w, int16_t h) {
+  if (_busPeriodUs == 0 || w <= 0) {
+    _disp->drawRGBBitmap(x, y, bitmap, w, h);
+    return;
+  }
+  while (h > 0) {
+    int16_t rows = busRows(w, h);
+    uint32_t t0 = micros();
+    _disp->drawRGBBitmap(x, y, bitmap, w, rows);
+    busDrawn(t0, (int32_t) w * rows);
+    bitmap += (int32_t) w * rows;
+    y += rows;
+    h -= rows;
+  }
+  busSlot();
+}
+
+/**************************************************************************/
+void TS_Display::mapLinear(int16_t TSx, int16_t TSy, int16_t* x, int16_t* y) {
+  if (_useAffine) {
+    affineMap(_affine, TSx, TSy, x, y);
+    return;
+  }
   *x = map(TSx, _TS_UL_X, _TS_LR_X, 0, _pixelsX);
   *y = map(TSy, _TS_UL_Y, _TS_LR_Y, 0, _pixelsY);
 }
 
+/**************************************************************************/
+int16_t TS_Display::lutCorrection(const int16_t* t, int16_t v) {
+  if (v < 0)
+    v = 0;
+  else if (v > 4095)
+    v = 4095;
+  uint8_t i = v >> TS_LUT_SHIFT;
+  int16_t frac = v & ((1 << TS_LUT_SHIFT) - 1);
+  int16_t a, b;
+  if (_lutProgmem) {
+    a = (int16_t) pgm_read_word(&t[i]);
+    b = (int16_t) pgm_read_word(&t[i+1]);
+  } else {
+    a = t[i];
+    b = t[i+1];
+  }
+  return(a + (int16_t) (((int32_t) (b - a) * frac +
+    (1 << (TS_LUT_SHIFT-1))) >> TS_LUT_SHIFT));
+}
+
+// Round a correction in 1/16 pixel to pixels.
+#define LUT_PIXELS(c)  (((c) + 8) >> 4)
+
+/**************************************************************************/
+void TS_Display::mapTStoDisplay(int16_t TSx, int16_t TSy, int16_t* x,
+    int16_t* y) {
+  mapLinear(TSx, TSy, x, y);
+  if (_lut != nullptr) {
+    *x += LUT_PIXELS(lutCorrection(_lut->x, TSx));
+    *y += LUT_PIXELS(lutCorrection(_lut->y, TSy));
+  }
+}
+
+/**************************************************************************/
+void TS_Display::currentAffine(TS_Affine* m) {
+  if (_useAffine) {
+    *m = _affine;
+    return;
+  }
+  // x = (TSx - _TS_UL_X) * _pixelsX / (_TS_LR_X - _TS_UL_X), likewise y.
+  int32_t dx = _TS_LR_X - _TS_UL_X;
+  int32_t dy = _TS_LR_Y - _TS_UL_Y;
+  m->a = (dx == 0) ? 0 : ((int32_t) _pixelsX * Q16_ONE) / dx;
+  m->b = 0;
+  m->c = -m->a * _TS_UL_X;
+  m->d = 0;
+  m->e = (dy == 0) ? 0 : ((int32_t) _pixelsY * Q16_ONE) / dy;
+  m->f = -m->e * _TS_UL_Y;
+}
+
+/**************************************************************************/
+void TS_Display::mapTStoDisplay(const TS_Point* in, TS_DisplayPoint* out,
+    size_t n) {
+  TS_Affine m;
+  currentAffine(&m);
+  const BatchMap bm(m);
+  for (size_t i = 0; i < n; i++)
+    bm.apply(in[i].x, in[i].y, &out[i].x, &out[i].y);
+  if (_lut != nullptr)
+    for (size_t i = 0; i < n; i++) {
+      out[i].x += LUT_PIXELS(lutCorrection(_lut->x, in[i].x));
+      out[i].y += LUT_PIXELS(lutCorrection(_lut->y, in[i].y));
+    }
+}
+
+/**************************************************************************/
+void TS_Display::mapTStoDisplay(int16_t* xs, int16_t* ys, size_t n) {
+  TS_Affine m;
+  currentAffine(&m);
+  const BatchMap bm(m);
+  if (_lut == nullptr) {
+    for (size_t i = 0; i < n; i++)
+      bm.apply(xs[i], ys[i], &xs[i], &ys[i]);
+    return;
+  }
+  for (size_t i = 0; i < n; i++) {
+    int16_t TSx = xs[i], TSy = ys[i];
+    bm.apply(TSx, TSy, &xs[i], &ys[i]);
+    xs[i] += LUT_PIXELS(lutCorrection(_lut->x, TSx));
+    ys[i] += LUT_PIXELS(lutCorrection(_lut->y, TSy));
+  }
+}
+
 /**************************************************************************/
 void TS_Display::mapDisplayToTS(int16_t x, int16_t y, int16_t* TSx,
     int16_t* TSy) {
+  mapLinearInverse(x, y, TSx, TSy);
+  if (_lut != nullptr) {
+    // The correction depends on the unknown touchscreen point, so estimate it
+    // at the uncorrected point and remove it.
+    int16_t dx = LUT_PIXELS(lutCorrection(_lut->x, *TSx));
+    int16_t dy = LUT_PIXELS(lutCorrection(_lut->y, *TSy));
+    mapLinearInverse(x - dx, y - dy, TSx, TSy);
+  }
+}
+
+/**************************************************************************/
+void TS_Display::mapLinearInverse(int16_t x, int16_t y, int16_t* TSx,
+    int16_t* TSy) {
+  if (_useAffine) {
+    affineMap(_affineInv, x, y, TSx, TSy);
+    return;
+  }
   *TSx = map(x, 0, _pixelsX, _TS_UL_X, _TS_LR_X);
   *TSy = map(y, 0, _pixelsY, _TS_UL_Y, _TS_LR_Y);
 }
@@ -180,4 +754,171 @@ void TS_Display::findTS_calibration(int16_t x_UL, int16_t y_UL, int16_t x_LR,
   *TS_LR_Y = (int16_t) (TSy_UL + (_pixelsY - y_UL)*sy);
 }
 
+/**************************************************************************/
+bool TS_Display::findTS_calibration(const int16_t* x, const int16_t* y,
+    const int16_t* TSx, const int16_t* TSy, uint8_t n, TS_Affine* cal) {
+
+  if (n < 3)
+    return(false);
+
+  // Least-squares fit of x = a*TSx + b*TSy + c and y = d*TSx + e*TSy + f,
+  // using coordinates relative to their means to keep the sums small.
+  float mu = 0, mv = 0, mx = 0, my = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    mu += TSx[i];
+    mv += TSy[i];
+    mx += x[i];
+    my += y[i];
+  }
+  mu /= n;
+  mv /= n;
+  mx /= n;
+  my /= n;
+
+  float suu = 0, suv = 0, svv = 0, sux = 0, svx = 0, suy = 0, svy = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    float u = TSx[i] - mu;
+    float v = TSy[i] - mv;
+    float dx = x[i] - mx;
+    float dy = y[i] - my;
+    suu += u*u;
+    suv += u*v;
+    svv += v*v;
+    sux += u*dx;
+    svx += v*dx;
+    suy += u*dy;
+    svy += v*dy;
+  }
+
+  // The points are collinear if the touchscreen coordinates span no area.
+  float det = suu*svv - suv*suv;
+  if (det <= 1e-3f * suu * svv)
+    return(false);
+
+  float a = (sux*svv - svx*suv) / det;
+  float b = (svx*suu - sux*suv) / det;
+  float d = (suy*svv - svy*suv) / det;
+  float e = (svy*suu - suy*suv) / det;
+
+  cal->a = toQ16(a);
+  cal->b = toQ16(b);
+  cal->c = toQ16(mx - a*mu - b*mv);
+  cal->d = toQ16(d);
+  cal->e = toQ16(e);
+  cal->f = toQ16(my - d*mu - e*mv);
+  return(true);
+}
+
+/**************************************************************************/
+// Points of one axis grouped into lines (grid columns or rows) with the same
+// display coordinate, with sums of their touchscreen coordinates and of the
+// errors of the current mapping at them.
+struct LutLines {
+  uint8_t count;
+  int16_t d[TS_LUT_MAX_LINES];
+  float ts[TS_LUT_MAX_LINES];
+  float err[TS_LUT_MAX_LINES];
+  uint8_t n[TS_LUT_MAX_LINES];
+
+  LutLines() : count(0) {}
+
+  // Add a point at display coordinate d with touchscreen coordinate ts and
+  // mapping error err, returning false if there are too many lines.
+  bool add(int16_t dv, int16_t tsv, float errv) {
+    uint8_t j = 0;
+    while (j < count && d[j] != dv)
+      j++;
+    if (j == count) {
+      if (count == TS_LUT_MAX_LINES)
+        return(false);
+      d[j] = dv;
+      ts[j] = err[j] = 0;
+      n[j] = 0;
+      count++;
+    }
+    ts[j] += tsv;
+    err[j] += errv;
+    n[j]++;
+    return(true);
+  }
+
+  // Compute correction table t from the lines, returning false if there are
+  // fewer than two.
+  bool makeTable(int16_t* t) {
+    if (count < 2)
+      return(false);
+    for (uint8_t j = 0; j < count; j++) {
+      ts[j] /= n[j];
+      err[j] /= n[j];
+    }
+
+    // Sort the lines by touchscreen coordinate.
+    for (uint8_t i = 1; i < count; i++) {
+      float a = ts[i], b = err[i];
+      uint8_t j = i;
+      for (; j > 0 && ts[j-1] > a; j--) {
+        ts[j] = ts[j-1];
+        err[j] = err[j-1];
+      }
+      ts[j] = a;
+      err[j] = b;
+    }
+
+    // Interpolate the errors at each table entry, extrapolating the first and
+    // last segments beyond the outermost lines.
+    uint8_t j = 0;
+    for (uint8_t i = 0; i < TS_LUT_SIZE; i++) {
+      float v = (float) ((int32_t) i << TS_LUT_SHIFT);
+      while (j < count - 2 && v > ts[j+1])
+        j++;
+      float span = ts[j+1] - ts[j];
+      float e = err[j];
+      if (span > 0)
+        e += (v - ts[j]) * (err[j+1] - err[j]) / span;
+      e *= 16;
+      if (e > 32767)
+        e = 32767;
+      else if (e < -32768)
+        e = -32768;
+      t[i] = (int16_t) lround(e);
+    }
+    return(true);
+  }
+};
+
+/**************************************************************************/
+bool TS_Display::findTS_correction(const int16_t* x, const int16_t* y,
+    const int16_t* TSx, const int16_t* TSy, uint8_t n, TS_AxisLUT* lut) {
+  LutLines cols, rows;
+  for (uint8_t i = 0; i < n; i++) {
+    int16_t mx, my;
+    mapLinear(TSx[i], TSy[i], &mx, &my);
+    if (!cols.add(x[i], TSx[i], x[i] - mx) || !rows.add(y[i], TSy[i], y[i] - my))
+      return(false);
+  }
+  return(cols.makeTable(lut->x) && rows.makeTable(lut->y));
+}
+
+/**************************************************************************/
+bool TS_Display::setTS_calibration(const TS_Affine& cal) {
+  float a = (float) cal.a / Q16_ONE, b = (float) cal.b / Q16_ONE;
+  float d = (float) cal.d / Q16_ONE, e = (float) cal.e / Q16_ONE;
+  float c = (float) cal.c / Q16_ONE, f = (float) cal.f / Q16_ONE;
+  float det = a*e - b*d;
+  if (det == 0)
+    return(false);
+
+  // Inverse of [a b; d e], applied to (x - c, y - f).
+  float ia = e/det, ib = -b/det, id = -d/det, ie = a/det;
+  _affineInv.a = toQ16(ia);
+  _affineInv.b = toQ16(ib);
+  _affineInv.c = toQ16(-(ia*c + ib*f));
+  _affineInv.d = toQ16(id);
+  _affineInv.e = toQ16(ie);
+  _affineInv.f = toQ16(-(id*c + ie*f));
+  _affine = cal;
+  _useAffine = true;
+  return(true);
+}
+
 // -------------------------------------------------------------------------
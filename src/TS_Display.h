@@ -59,6 +59,8 @@
   The third of the above can be used together with user GUI code to provide a
   screen where the user can touch two opposite corners of the display, so the
   touchscreen coordinates of those points can be used to calibrate the mapping.
+  Touching three or more points instead allows an affine calibration, which
+  also corrects skew and rotation of the touchscreen relative to the display.
   Although the default mapping parameter values work well in most cases,
   calibration may be desirable because it seems that factory calibration is not
   highly accurate.
@@ -86,6 +88,31 @@
 #include <Adafruit_GFX.h>
 #include <XPT2046_Touchscreen_TT.h>
 
+struct TS_Calibration;
+class TS_CalStorage;
+class TS_HitTable;
+class TS_CalRefiner;
+
+// The four TS_ constants below are used to set the initial default calibration
+// parameter values to reasonable values probably suitable for most touchscreens.
+// The screen rotation is taken into account when using the values below to
+// initialize the mapping parameter values. In rotation mode 2 the values below
+// can be directly assigned to the calibration parameters, but in the other
+// rotation modes an offset must be applied.
+//
+// In the constant names, "SHORT" refers to either x- or y- coordinate,
+// depending on which direction is shorter in size for the current rotation,
+// and "LONG" refers to the opposite direction that is longer in size.
+#define TS_UL_SHORT  3800
+#define TS_UL_LONG   3700
+#define TS_LR_SHORT  275
+#define TS_LR_LONG   165
+
+// Value used to "flip" touchscreen coordinates. This value is used within the
+// original touchscreen code, and it is required here in order to properly
+// adjust the mapping parameter values in rotation modes 0 and 1.
+#define TS_OFFSET 4095
+
 // Default milliseconds of touch before touch recognized, or absence of touch
 // before release recognized.
 #define DEF_DEBOUNCE_MS_TR  20
@@ -94,6 +121,17 @@
 #define DEF_MIN_TOUCH_PRES    5
 #define DEF_MAX_RELEASE_PRES  0
 
+// Number of entries per axis in a TS_AxisLUT correction table, spaced
+// 1 << TS_LUT_SHIFT touchscreen units apart over 0-4096.
+#define TS_LUT_SHIFT  7
+#define TS_LUT_SIZE   ((4096 >> TS_LUT_SHIFT) + 1)
+
+// Maximum number of distinct display x- or y-coordinates in the points given
+// to findTS_correction(), i.e. grid columns or rows.
+#ifndef TS_LUT_MAX_LINES
+#define TS_LUT_MAX_LINES  16
+#endif
+
 /**************************************************************************/
 /*!
   @brief    Enum eTouchEvent has five TS_ constants, two for touch and release
@@ -107,9 +145,96 @@ typedef enum _eTouchEvent {
   TS_NO_TOUCH,        /*! State, not event: screen not being touched. */
   TS_TOUCH_PRESENT,   /*! State, not event: screen is being touched. */
   TS_TOUCH_EVENT,     /*! Event: debounced touch, next event will be release. */
-  TS_RELEASE_EVENT    /*! Event: debounced release, next event will be touch. */
+  TS_RELEASE_EVENT,   /*! Event: debounced release, next event will be touch. */
+  TS_MOVE_EVENT       /*! Event: touch moved, from pollEvent() only. */
 } eTouchEvent;
 
+// Minimum change in display x- or y-coordinate, in pixels, for pollEvent() to
+// report a TS_MOVE_EVENT.
+#ifndef TS_MOVE_MIN_PIXELS
+#define TS_MOVE_MIN_PIXELS  1
+#endif
+
+// Default alpha and beta gains of the touch position predictor, as fractions
+// times 256, the longest gap between samples, in ms, before the predictor
+// restarts, the longest time, in ms, it extrapolates ahead of the last
+// sample, and the shortest time, in us, by which a velocity correction is
+// divided, so samples closer together than a sample interval cannot make the
+// velocity jump.
+#define TS_PREDICT_ALPHA          128
+#define TS_PREDICT_BETA           32
+#ifndef TS_PREDICT_MAX_GAP_MS
+#define TS_PREDICT_MAX_GAP_MS     50
+#endif
+#ifndef TS_PREDICT_MAX_AHEAD_MS
+#define TS_PREDICT_MAX_AHEAD_MS   50
+#endif
+#ifndef TS_PREDICT_MIN_DT_US
+#define TS_PREDICT_MIN_DT_US      1000
+#endif
+
+// Initial estimate of the display's fill speed, in nanoseconds per pixel, used
+// to size the chunks of drawing done between scheduled touch samples until it
+// has been measured.
+#ifndef TS_BUS_NS_PER_PIXEL
+#define TS_BUS_NS_PER_PIXEL 500
+#endif
+
+/**************************************************************************/
+/*!
+  @brief    Struct TS_Event holds one touch, release, or move event returned by
+            TS_Display::pollEvent().
+*/
+/**************************************************************************/
+struct TS_Event {
+  eTouchEvent type;   // TS_TOUCH_EVENT, TS_RELEASE_EVENT, or TS_MOVE_EVENT
+  int16_t x, y;       // Display coordinates
+  int16_t TSx, TSy;   // Touchscreen coordinates
+  int16_t pres;       // Touch pressure, 0 for release
+  uint32_t us;        // micros() time of the sample that started the event
+  uint8_t region;     // Hit region id, TS_NO_REGION if none (TS_HitTable.h)
+};
+
+/**************************************************************************/
+/*!
+  @brief    Struct TS_Affine holds an affine mapping from touchscreen to display
+            coordinates as a 2x3 matrix of Q16 fixed-point values (the real
+            value times 65536):
+
+              x = a*TSx + b*TSy + c
+              y = d*TSx + e*TSy + f
+*/
+/**************************************************************************/
+struct TS_Affine {
+  int32_t a, b, c;
+  int32_t d, e, f;
+};
+
+/**************************************************************************/
+/*!
+  @brief    Struct TS_AxisLUT holds tables correcting nonlinearity of the
+            touchscreen near its edges. Entry i of x (y) is the correction, in
+            1/16 pixel, added to the display x-coordinate (y-coordinate) mapped
+            from touchscreen x-coordinate (y-coordinate) i << TS_LUT_SHIFT,
+            and corrections in between are linearly interpolated. A table may
+            be stored in PROGMEM.
+*/
+/**************************************************************************/
+struct TS_AxisLUT {
+  int16_t x[TS_LUT_SIZE];
+  int16_t y[TS_LUT_SIZE];
+};
+
+/**************************************************************************/
+/*!
+  @brief    Struct TS_DisplayPoint holds a display pixel coordinate, as returned
+            by the batch form of TS_Display::mapTStoDisplay().
+*/
+/**************************************************************************/
+struct TS_DisplayPoint {
+  int16_t x, y;
+};
+
 /**************************************************************************/
 /*!
   @brief    Class TS_Display manages the interface between a touchscreen
@@ -122,6 +247,8 @@ typedef enum _eTouchEvent {
 /**************************************************************************/
 class TS_Display {
 
+  friend class TS_CalRefiner;
+
 protected:
 
   // The touchscreen object associated with the class instance using begin().
@@ -158,6 +285,20 @@ protected:
   // Minimum pressure for touch event, maximum for release event.
   int16_t _minTouchPres, _maxReleasePres;
 
+  // true if the affine calibration below is used for mapping instead of the
+  // four _TS_ variables above.
+  bool _useAffine;
+
+  // Affine calibration mapping touchscreen to display coordinates, and its
+  // inverse mapping display to touchscreen coordinates, both Q16.
+  TS_Affine _affine;
+  TS_Affine _affineInv;
+
+  // Nonlinearity correction tables added to the mapping, nullptr if none, and
+  // true if they are in PROGMEM.
+  const TS_AxisLUT* _lut;
+  bool _lutProgmem;
+
 private:
 
   // true if last touchscreen event was a touch event, false if release event.
@@ -170,6 +311,109 @@ private:
   int16_t _pixelsX;
   int16_t _pixelsY;
 
+  // Event queue storage, capacity, index of oldest event, number of events,
+  // and number of events dropped because it was full.
+  TS_Event* _events;
+  uint8_t _eventCap;
+  uint8_t _eventHead;
+  uint8_t _eventCount;
+  uint32_t _eventOverflows;
+
+  // Event queue debounce state: true if the last touch or release event was
+  // a touch, true while a change to the opposite state is being debounced,
+  // the micros() time and point at which that change started, and the
+  // display position last reported.
+  bool _evTouch;
+  bool _evPending;
+  uint32_t _evSince;
+  TS_Point _evSincePoint;
+  int16_t _evX, _evY;
+
+  // Hit region table if any, id of the region of the last event returned by
+  // getTouchEvent(), and last touched display position.
+  TS_HitTable* _hitTable;
+  uint8_t _hitRegion;
+  int16_t _touchX, _touchY;
+
+  // Return id of hit region containing display position (x,y).
+  uint8_t hitTest(int16_t x, int16_t y);
+
+  // Calibration refiner if any, hit region of the last touch event, and sums
+  // and number of the touchscreen coordinates of the touched samples since
+  // the last release event.
+  TS_CalRefiner* _refiner;
+  uint8_t _tapRegion;
+  int32_t _tapSumX, _tapSumY;
+  uint16_t _tapCount;
+
+  // Add a touched sample to the tap sums.
+  void tapSample(const TS_Point& p);
+
+  // Handle a touch (touch true) or release event in hit region 'region',
+  // passing a touch and release in the same region to the refiner as a tap.
+  void tapEvent(bool touch, uint8_t region);
+
+  // Touch position predictor: enabled flag, gains as fractions times 256,
+  // whether it has a position, the filtered position in 1/256 pixel, the
+  // velocity in 1/256 pixel per ms, and the micros() time of the last sample.
+  bool _predict;
+  uint8_t _predAlpha, _predBeta;
+  bool _predValid;
+  int32_t _predX, _predY;
+  int32_t _predVx, _predVy;
+  uint32_t _predUs;
+
+  // Shared bus schedule: touch sample period in us (0 if not scheduled),
+  // whether a sample has been taken and its micros() time, number of periods
+  // missed, longest time between samples, and measured display fill time per
+  // pixel in ns.
+  uint32_t _busPeriodUs;
+  bool _busStarted;
+  uint32_t _busLastUs;
+  uint32_t _busMisses;
+  uint32_t _busMaxGapUs;
+  uint32_t _busNsPerPixel;
+
+  // Record that the touchscreen was sampled at micros() time now.
+  void busSampled(uint32_t now);
+
+  // Take a touch sample if one is due, then return the number of rows of w
+  // pixels (at least 1, at most h) that can be drawn before the next is due.
+  int16_t busRows(int16_t w, int16_t h);
+
+  // Update the fill speed estimate with a chunk of 'pixels' pixels drawn
+  // starting at micros() time t0.
+  void busDrawn(uint32_t t0, int32_t pixels);
+
+  // Feed a touched sample at display position (x,y) read at micros() time us
+  // to the predictor. A sample with the same time as the last one is ignored.
+  void predictSample(int16_t x, int16_t y, uint32_t us);
+
+  // Alpha-beta filter update of one axis with a measurement and the time in
+  // us since the last one.
+  void predictAxis(int32_t* pos, int32_t* vel, int16_t meas, uint32_t dt);
+
+  // Run the event queue debounce state machine on one sample at micros() time
+  // us, feeding it to the predictor with the time sampleUs it was read.
+  void eventSample(const TS_Point& p, uint32_t us, uint32_t sampleUs);
+
+  // Add an event to the event queue for point p at time us, coalescing
+  // consecutive move events.
+  void pushEvent(eTouchEvent type, const TS_Point& p, uint32_t us);
+
+  // Return the current calibration as an affine mapping, converting the
+  // two-point calibration parameters if those are in use.
+  void currentAffine(TS_Affine* m);
+
+  // Map between touchscreen and display coordinates using the two-point or
+  // affine calibration only, without the correction tables.
+  void mapLinear(int16_t TSx, int16_t TSy, int16_t* x, int16_t* y);
+  void mapLinearInverse(int16_t x, int16_t y, int16_t* TSx, int16_t* TSy);
+
+  // Return the correction in 1/16 pixel from correction table t for
+  // touchscreen coordinate v.
+  int16_t lutCorrection(const int16_t* t, int16_t v);
+
 public:
 
   /**************************************************************************/
@@ -180,7 +424,17 @@ public:
   TS_Display() : _ts(nullptr), _disp(nullptr), _TS_LR_X(0), _TS_LR_Y(0),
       _TS_UL_X(0), _TS_UL_Y(0), _debounceMS_TR(DEF_DEBOUNCE_MS_TR),
       _minTouchPres(DEF_MIN_TOUCH_PRES), _maxReleasePres(DEF_MAX_RELEASE_PRES),
-      _lastEventWasTouch(false), _msTime(millis()), _pixelsX(0), _pixelsY(0) {}
+      _useAffine(false), _affine(), _affineInv(), _lut(nullptr),
+      _lutProgmem(false), _lastEventWasTouch(false), _msTime(millis()), _pixelsX(0), _pixelsY(0),
+      _events(nullptr), _eventCap(0), _eventHead(0), _eventCount(0),
+      _eventOverflows(0), _evTouch(false), _evPending(false), _evSince(0),
+      _evSincePoint(), _evX(0), _evY(0), _hitTable(nullptr),
+      _hitRegion(0xFF), _touchX(0), _touchY(0), _refiner(nullptr),
+      _tapRegion(0xFF), _tapSumX(0), _tapSumY(0), _tapCount(0), _predict(false),
+      _predAlpha(TS_PREDICT_ALPHA), _predBeta(TS_PREDICT_BETA),
+      _predValid(false), _predX(0), _predY(0), _predVx(0), _predVy(0),
+      _predUs(0), _busPeriodUs(0), _busStarted(false), _busLastUs(0),
+      _busMisses(0), _busMaxGapUs(0), _busNsPerPixel(TS_BUS_NS_PER_PIXEL) {}
 
   /**************************************************************************/
   /*!
@@ -195,6 +449,26 @@ public:
   /**************************************************************************/
   void begin(XPT2046_Touchscreen* ts, Adafruit_GFX* disp);
 
+  /**************************************************************************/
+  /*!
+    @brief  Class instance initialization function that also loads a saved
+            calibration, so the display is calibrated at once on power-up.
+    @param  ts        Pointer to the instance of the touchscreen object.
+    @param  disp      Pointer to the instance of the display object.
+    @param  storage   Non-volatile memory holding the calibration record.
+    @param  cal       Pointer to record to load the calibration into. It must
+                      remain in existence (e.g. be a global), since its
+                      correction tables, if any, are used in place.
+    @returns  true if a valid calibration record for the display rotation was
+              loaded and set, false if there was none, in which case the
+              default calibration is in effect, as after begin(ts, disp).
+    @note   The record is read with one read and used without recomputation.
+            It also sets the touchscreen pressure thresholds.
+  */
+  /**************************************************************************/
+  bool begin(XPT2046_Touchscreen* ts, Adafruit_GFX* disp,
+    TS_CalStorage* storage, TS_Calibration* cal);
+
   /**************************************************************************/
   /*!
     @brief  Get current touchscreen state OR last touch or release event. An
@@ -222,6 +496,223 @@ public:
   eTouchEvent getTouchEvent(int16_t& x, int16_t& y, int16_t& pres,
     int16_t* px=nullptr, int16_t* py=nullptr);
 
+  /**************************************************************************/
+  /*!
+    @brief  Attach a table of hit regions, so touch and release events carry
+            the id of the region they are in.
+    @param  table   The table, or nullptr to detach it. Its index is built for
+                    the display size, which must be set (i.e. begin() must
+                    have been called).
+    @note   Regions may be added to the table after it is attached, and the
+            index is then rebuilt on the next lookup.
+  */
+  /**************************************************************************/
+  void attachHitTable(TS_HitTable* table);
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the hit region of the last touch or release event returned
+            by getTouchEvent().
+    @returns  The region id of the touch position of that event, or for a
+              release event, of the last touched position, or TS_NO_REGION if
+              it is in no region or no hit table is attached.
+  */
+  /**************************************************************************/
+  uint8_t hitRegion() { return(_hitRegion); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Attach a calibration refiner, which is then given every tap on a
+            hit region, aimed at the region's center (see TS_CalRefiner.h).
+    @param  refiner   The refiner, whose begin() has been called with this
+                      object, or nullptr to detach it.
+    @note   A tap is a touch event and the following release event in the
+            same region, and its touchscreen position is the mean of the
+            touched samples read by getTouchEvent() or pollEvent() since the
+            previous release. A hit table must be attached.
+  */
+  /**************************************************************************/
+  void attachRefiner(TS_CalRefiner* refiner) {
+    _refiner = refiner;
+    _tapRegion = 0xFF;
+    _tapSumX = _tapSumY = 0;
+    _tapCount = 0;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Attach storage for an event queue, used by pollEvent().
+    @param  buf       Array of capacity events, or nullptr to detach the queue.
+    @param  capacity  Number of events in buf, at most 255.
+  */
+  /**************************************************************************/
+  void attachEventQueue(TS_Event* buf, uint8_t capacity);
+
+  /**************************************************************************/
+  /*!
+    @brief  Get the next touch, release, or move event from the event queue.
+    @param  ev    Reference to variable to receive the event.
+    @returns  true if an event was returned, false if there are none or no
+              event queue is attached.
+    @note   Each call first runs the touch/release debounce on every sample
+            produced since the last call, taking them from the touchscreen's
+            sample queue if one is attached (see TS_SampleRing.h) or else
+            reading one with getPoint(). Debouncing uses the sample
+            timestamps, so no event is lost and the event times do not
+            depend on how often this is called, as long as the sample queue
+            does not overflow.
+    @note   A TS_MOVE_EVENT is queued when the display position of a touch
+            changes by at least TS_MOVE_MIN_PIXELS. Consecutive move events
+            are merged into one if they are not consumed in time.
+    @note   Don't mix calls to this and to getTouchEvent().
+  */
+  /**************************************************************************/
+  bool pollEvent(TS_Event& ev);
+
+  /**************************************************************************/
+  /*!
+    @brief  Return number of events dropped because the event queue was full.
+    @returns  Number of dropped events.
+  */
+  /**************************************************************************/
+  uint32_t eventOverflows() { return(_eventOverflows); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Enable or disable the touch position predictor.
+    @param  enable  true to enable it.
+    @param  alpha   Position gain, a fraction times 256. Smaller values
+                    suppress more jitter but follow the touch more slowly.
+    @param  beta    Velocity gain, a fraction times 256. Smaller values give a
+                    steadier but slower-reacting velocity estimate.
+    @note   The predictor is an alpha-beta filter in fixed point, fed with the
+            display position of each new touched sample read by
+            getTouchEvent() or pollEvent(), at the time the sample was read.
+            It restarts at each
+            touch, and after a gap of more than TS_PREDICT_MAX_GAP_MS between
+            samples.
+  */
+  /**************************************************************************/
+  void setPredictor(bool enable, uint8_t alpha = TS_PREDICT_ALPHA,
+    uint8_t beta = TS_PREDICT_BETA);
+
+  /**************************************************************************/
+  /*!
+    @brief  Predict where the touch will be a given time from now, e.g. at the
+            time the display will show what is drawn now, to compensate for
+            the latency of sampling, filtering, debouncing, and drawing.
+    @param  msAhead   Milliseconds from now. With 0, the returned position is
+                      the filtered current position, with jitter suppressed.
+    @param  x         Pointer to variable to receive predicted display
+                      x-coordinate.
+    @param  y         Pointer to variable to receive predicted display
+                      y-coordinate.
+    @returns  true if a position was returned, false if the predictor is
+              disabled or the screen is not being touched.
+    @note   The prediction extrapolates at most TS_PREDICT_MAX_AHEAD_MS past
+            the last sample, and is limited to the display.
+  */
+  /**************************************************************************/
+  bool predictPoint(uint32_t msAhead, int16_t* x, int16_t* y);
+
+  /**************************************************************************/
+  /*!
+    @brief  Set the touch sampling period to be kept while drawing, when the
+            touchscreen and display share an SPI bus.
+    @param  periodUs  Period in microseconds, or 0 to stop scheduling.
+    @note   Drawing done with this class's fillRect(), fillScreen(), and
+            drawRGBBitmap() is then split into chunks of rows, each sized from
+            the measured drawing speed to end by the time the next touch
+            sample is due, and the touchscreen is sampled between chunks, so
+            neither device waits for the other. Other drawing can call
+            busSlot() between calls to the display. The touchscreen's own
+            sample interval (setSampleInterval()) should not be longer than
+            periodUs.
+    @note   Samples taken between chunks are read with the touchscreen's
+            getPoint(), so they reach pollEvent() through the touchscreen's
+            sample queue if one is attached, and otherwise are fed to the
+            event queue directly.
+  */
+  /**************************************************************************/
+  void setBusSchedule(uint32_t periodUs);
+
+  /**************************************************************************/
+  /*!
+    @brief  Sample the touchscreen if a scheduled sample is due. Call this
+            between display operations that don't go through this class.
+    @returns  true if a sample was taken, false if none was due or no schedule
+              is set.
+  */
+  /**************************************************************************/
+  bool busSlot();
+
+  /**************************************************************************/
+  /*!
+    @brief  Fill a rectangle on the display, in chunks between scheduled touch
+            samples. Without a schedule, calls the display's fillRect().
+    @param  x       Display x-coordinate of upper-left corner.
+    @param  y       Display y-coordinate of upper-left corner.
+    @param  w       Width in pixels.
+    @param  h       Height in pixels.
+    @param  color   16-bit 5-6-5 color.
+  */
+  /**************************************************************************/
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+  /**************************************************************************/
+  /*!
+    @brief  Fill the display, in chunks between scheduled touch samples.
+    @param  color   16-bit 5-6-5 color.
+  */
+  /**************************************************************************/
+  void fillScreen(uint16_t color) { fillRect(0, 0, _pixelsX, _pixelsY, color); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Draw a 16-bit color bitmap on the display, in chunks of rows
+            between scheduled touch samples. Without a schedule, calls the
+            display's drawRGBBitmap().
+    @param  x       Display x-coordinate of upper-left corner.
+    @param  y       Display y-coordinate of upper-left corner.
+    @param  bitmap  Array of w*h 5-6-5 colors, row by row, in RAM.
+    @param  w       Width in pixels.
+    @param  h       Height in pixels.
+  */
+  /**************************************************************************/
+  void drawRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w,
+    int16_t h);
+
+  /**************************************************************************/
+  /*!
+    @brief  Return number of scheduled touch samples missed.
+    @returns  Number of whole sample periods, since setBusSchedule() or the
+              last resetBusStats(), during which getTouchEvent(), pollEvent(),
+              and busSlot() took no sample.
+  */
+  /**************************************************************************/
+  uint32_t busDeadlineMisses() { return(_busMisses); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the longest time between touch samples.
+    @returns  Longest time in microseconds between two samples taken by
+              getTouchEvent(), pollEvent(), or busSlot() since
+              setBusSchedule() or the last resetBusStats().
+  */
+  /**************************************************************************/
+  uint32_t busMaxGapUs() { return(_busMaxGapUs); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Reset the deadline miss count and longest gap to 0.
+  */
+  /**************************************************************************/
+  void resetBusStats() {
+    _busMisses = 0;
+    _busMaxGapUs = 0;
+    _busStarted = false;
+  }
+
   /**************************************************************************/
   /*!
     @brief  Set parameters for touch/release event detection.
@@ -249,10 +740,43 @@ public:
     @param  x     Pointer to variable to receive display x-coordinate.
     @param  y     Pointer to variable to receive display y-coordinate.
     @note   Mapping depends on the screen rotation, assumed to be fixed.
+    @note   With an affine calibration set, the mapping uses two multiplies
+            and adds and one shift per coordinate, with no division.
   */
   /**************************************************************************/
   void mapTStoDisplay(int16_t TSx, int16_t TSy, int16_t* x, int16_t* y);
 
+  /**************************************************************************/
+  /*!
+    @brief  Map an array of touchscreen points to display points.
+    @param  in    Array of n touchscreen points, e.g. from readSamples().
+    @param  out   Array to receive the n display points.
+    @param  n     Number of points.
+    @note   The calibration is converted to a fixed-point matrix once per call,
+            so the per-point cost is two multiply-adds and a shift per
+            coordinate. On processors with the ARM DSP extension (Cortex-M4,
+            M7), each coordinate takes a single SMLAD instruction.
+    @note   With the two-point calibration, results are rounded rather than
+            truncated as map() does, so they may differ from the single-point
+            mapTStoDisplay() by one pixel.
+  */
+  /**************************************************************************/
+  void mapTStoDisplay(const TS_Point* in, TS_DisplayPoint* out, size_t n);
+
+  /**************************************************************************/
+  /*!
+    @brief  Map arrays of touchscreen coordinates to display coordinates in
+            place.
+    @param  xs    Array of n touchscreen x-coordinates, replaced by display
+                  x-coordinates.
+    @param  ys    Array of n touchscreen y-coordinates, replaced by display
+                  y-coordinates.
+    @param  n     Number of points.
+    @note   See the notes for the TS_Point array form above.
+  */
+  /**************************************************************************/
+  void mapTStoDisplay(int16_t* xs, int16_t* ys, size_t n);
+
   /**************************************************************************/
   /*!
     @brief  Reverse map a display point (x, y) to a touchscreen point (TSx, TSy).
@@ -314,6 +838,29 @@ public:
     int16_t TSy_LR, int16_t* TS_LR_X, int16_t* TS_LR_Y, int16_t* TS_UL_X,
     int16_t* TS_UL_Y);
 
+  /**************************************************************************/
+  /*!
+    @brief  Use three or more touchscreen coordinate pairs at specified display
+            coordinates to compute an affine calibration, which corrects skew
+            and rotation as well as scale and offset.
+    @param  x     Array of n display x-coordinates.
+    @param  y     Array of n display y-coordinates.
+    @param  TSx   Array of n corresponding touchscreen x-coordinates.
+    @param  TSy   Array of n corresponding touchscreen y-coordinates.
+    @param  n     Number of points, at least 3. With 3 points the mapping is
+                  exact; with more it is the least-squares fit.
+    @param  cal   Pointer to variable to receive the calibration.
+    @returns  true if successful, false if there are too few points or they
+              lie on a line, so that no mapping can be found.
+    @note   The returned calibration is NOT set as the current one. Call
+            setTS_calibration() to do that.
+    @note   Accuracy is best with points spread over the whole display, e.g.
+            three corners, or a grid for a least-squares fit.
+  */
+  /**************************************************************************/
+  bool findTS_calibration(const int16_t* x, const int16_t* y,
+    const int16_t* TSx, const int16_t* TSy, uint8_t n, TS_Affine* cal);
+
   /**************************************************************************/
   /*!
     @brief  Return the current calibration parameter values.
@@ -346,7 +893,113 @@ public:
     _TS_LR_Y = TS_LR_Y;
     _TS_UL_X = TS_UL_X;
     _TS_UL_Y = TS_UL_Y;
+    _useAffine = false;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the current affine calibration.
+    @param  cal   Pointer to variable to receive the calibration.
+    @returns  true if an affine calibration is in use, false if the two-point
+              calibration parameters are in use, in which case cal is not set.
+  */
+  /**************************************************************************/
+  bool getTS_calibration(TS_Affine* cal) {
+    if (!_useAffine)
+      return(false);
+    *cal = _affine;
+    return(true);
   }
+
+  /**************************************************************************/
+  /*!
+    @brief  Set an affine calibration as the current calibration, replacing
+            the two-point calibration parameters until setTS_calibration() is
+            called with those again.
+    @param  cal   The new calibration, from findTS_calibration().
+    @returns  true if successful, false if the mapping is not invertible, in
+              which case the current calibration is unchanged.
+  */
+  /**************************************************************************/
+  bool setTS_calibration(const TS_Affine& cal);
+
+  /**************************************************************************/
+  /*!
+    @brief  Use a grid of touchscreen coordinate pairs at specified display
+            coordinates to compute tables correcting the remaining error of
+            the current calibration, which is largest near the edges.
+    @param  x     Array of n display x-coordinates.
+    @param  y     Array of n display y-coordinates.
+    @param  TSx   Array of n corresponding touchscreen x-coordinates.
+    @param  TSy   Array of n corresponding touchscreen y-coordinates.
+    @param  n     Number of points.
+    @param  lut   Pointer to variable to receive the correction tables.
+    @returns  true if successful, false if the points have fewer than 2 or
+              more than TS_LUT_MAX_LINES distinct display x- or y-coordinates.
+    @note   The points should form a grid, e.g. 5x5 points reaching close to
+            the display edges. Points with the same display x-coordinate form a
+            column whose mean touchscreen x-coordinate and mean error give one
+            point of the x-axis correction, likewise for rows and y, and the
+            table is interpolated between, and extrapolated beyond, those.
+    @note   First set the calibration (setTS_calibration()), usually computed
+            from the same points, since the correction is relative to it. The
+            correction tables are NOT set as the current ones; call
+            setTS_correction() to do that. They can be printed and copied into
+            a PROGMEM table in the application.
+  */
+  /**************************************************************************/
+  bool findTS_correction(const int16_t* x, const int16_t* y,
+    const int16_t* TSx, const int16_t* TSy, uint8_t n, TS_AxisLUT* lut);
+
+  /**************************************************************************/
+  /*!
+    @brief  Set the nonlinearity correction tables used by all mapping
+            functions.
+    @param  lut       The correction tables, or nullptr for no correction. They
+                      are not copied, so they must remain in existence.
+    @param  progmem   true if lut is in PROGMEM.
+    @note   With correction, each mapped coordinate costs one extra table read
+            and one linear interpolation.
+  */
+  /**************************************************************************/
+  void setTS_correction(const TS_AxisLUT* lut, bool progmem = false) {
+    _lut = lut;
+    _lutProgmem = progmem;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Fill a calibration record with the current calibration, the
+            touch/release event parameters, and the touchscreen pressure
+            thresholds, including its CRC.
+    @param  cal   Pointer to the record to fill.
+  */
+  /**************************************************************************/
+  void getCalibration(TS_Calibration* cal);
+
+  /**************************************************************************/
+  /*!
+    @brief  Set the calibration, touch/release event parameters, and
+            touchscreen pressure thresholds from a calibration record.
+    @param  cal   Pointer to the record. If it has correction tables, they are
+                  used in place, so it must remain in existence.
+    @returns  true if successful, false if the record is not valid (wrong
+              magic number, version, size, or CRC) or was made for a different
+              display rotation, in which case nothing is changed.
+  */
+  /**************************************************************************/
+  bool setCalibration(const TS_Calibration* cal);
+
+  /**************************************************************************/
+  /*!
+    @brief  Save the current calibration in non-volatile memory.
+    @param  storage   Non-volatile memory to save the calibration record in.
+    @param  cal       Pointer to record to fill with the current calibration
+                      using getCalibration() and write.
+    @returns  true if successful, else false.
+  */
+  /**************************************************************************/
+  bool saveCalibration(TS_CalStorage* storage, TS_Calibration* cal);
 };
 
 #endif // ILI9341_h
@@ -0,0 +1,364 @@
+/*
+  TS_DisplayT.h - Defines C++ class template TS_DisplayT, a variant of class
+  TS_Display whose calibration, event parameters, and display size are fixed
+  at compile time, and the templates TS_DefaultCal and TS_FixedMap it uses.
+  Released into the public domain.
+
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  Class TS_Display keeps its calibration parameters, event parameters, and
+  display size in RAM, and computes the mapping from them at run time, since
+  it can be calibrated at any time. A product whose panels are calibrated at
+  the factory, and never change, can instead fix all of those at compile time
+  in a configuration struct with static constexpr members, and class template
+  TS_DisplayT then folds them into the code: the mapping becomes a
+  subtraction, a multiply by a constant, and a shift per coordinate, and the
+  object holds only the touchscreen pointer and the debounce state. The
+  members of the struct are named after those of struct TS_Calibration:
+
+    struct MyPanel : TS_DefaultCal<1, 320, 240> {
+      static constexpr int16_t TS_UL_X = 3822, TS_UL_Y = 3760;
+      static constexpr int16_t TS_LR_X = 190, TS_LR_Y = 261;
+    };
+
+    TS_DisplayT<MyPanel> ts_display;
+    ...
+    ts_display.begin(ts);
+
+  TS_DefaultCal<Rotation, Width, Height> has the calibration TS_Display::begin()
+  sets for a display rotation, and the default event parameters and pressure
+  thresholds, so a struct derived from it need only give the members that
+  differ. The calibration shown by example program TS_DisplayCalibrate.ino can
+  be copied into it.
+
+  TS_DisplayT works with XPT2046_Touchscreen or, through its second template
+  parameter, with XPT2046_TouchscreenT, and provides the TS_Display functions
+  getTouchEvent(), mapTStoDisplay(), and mapDisplayToTS(). Template
+  TS_FixedMap, which does the mapping, can be used on its own, and its
+  functions are constexpr, so a fixed display position can be mapped to the
+  touchscreen at compile time. The calibration is two-point (scale and offset
+  per axis); for affine calibration, correction tables, event queues, and the
+  other features of TS_Display, use TS_Display.
+*/
+/**************************************************************************/
+
+#ifndef TS_DisplayT_h
+#define TS_DisplayT_h
+
+#include <Arduino.h>
+#include <XPT2046_Touchscreen_TT.h>
+#include <TS_Display.h>
+
+/**************************************************************************/
+/*!
+  @brief    Configuration struct with the default calibration of TS_Display
+            for a display rotation and size, and the default touch/release
+            event parameters and touchscreen pressure thresholds. Derive a
+            struct from it to override some of them, as shown above.
+  @param    Rotation  Display rotation, 0-3.
+  @param    Width     Display width in pixels in that rotation.
+  @param    Height    Display height in pixels in that rotation.
+*/
+/**************************************************************************/
+template <uint8_t Rotation, int16_t Width, int16_t Height>
+struct TS_DefaultCal {
+  static_assert(Rotation < 4, "Rotation must be 0-3");
+
+  // Display size.
+  static constexpr int16_t width = Width;
+  static constexpr int16_t height = Height;
+
+  // Two-point calibration parameters, as set by TS_Display::begin().
+  static constexpr int16_t TS_UL_X =
+    (Rotation <= 1) ? TS_OFFSET - TS_LR_SHORT : TS_UL_SHORT;
+  static constexpr int16_t TS_UL_Y =
+    (Rotation == 0) ? TS_OFFSET - TS_LR_LONG :
+    (Rotation == 3) ? TS_OFFSET - TS_LR_LONG : TS_UL_SHORT;
+  static constexpr int16_t TS_LR_X =
+    (Rotation <= 1) ? TS_OFFSET - TS_UL_SHORT : TS_LR_SHORT;
+  static constexpr int16_t TS_LR_Y =
+    (Rotation == 0) ? TS_OFFSET - TS_UL_LONG :
+    (Rotation == 3) ? TS_OFFSET - TS_UL_LONG : TS_LR_SHORT;
+
+  // Touch/release event parameters.
+  static constexpr uint32_t debounceMS_TR = DEF_DEBOUNCE_MS_TR;
+  static constexpr int16_t minTouchPres = DEF_MIN_TOUCH_PRES;
+  static constexpr int16_t maxReleasePres = DEF_MAX_RELEASE_PRES;
+
+  // Touchscreen pressure thresholds.
+  static constexpr int16_t Z_Threshold = Z_THRESHOLD;
+  static constexpr int16_t Z_Threshold_Int = Z_THRESHOLD_INT;
+};
+
+/**************************************************************************/
+/*!
+  @brief    Two-point mapping between touchscreen and display coordinates with
+            the calibration of a configuration struct, with the scale factors
+            computed at compile time.
+  @param    Cal   Configuration struct, e.g. derived from TS_DefaultCal.
+  @note     Results are rounded rather than truncated as TS_Display's map()
+            based mapping does, so they may differ from it by one pixel.
+*/
+/**************************************************************************/
+template <class Cal>
+struct TS_FixedMap {
+
+  static_assert(Cal::TS_LR_X != Cal::TS_UL_X && Cal::TS_LR_Y != Cal::TS_UL_Y,
+    "Calibration UL and LR coordinates must differ");
+  static_assert(Cal::width > 0 && Cal::height > 0,
+    "Display size must be positive");
+
+  // Return n/d rounded to nearest.
+  static constexpr int32_t divRound(int32_t n, int32_t d) {
+    return(((n < 0) == (d < 0)) ? (n + d/2) / d : (n - d/2) / d);
+  }
+
+  // Q16 scale factors from touchscreen to display coordinates and back.
+  static constexpr int32_t SCALE_X =
+    divRound((int32_t) Cal::width * 65536, Cal::TS_LR_X - Cal::TS_UL_X);
+  static constexpr int32_t SCALE_Y =
+    divRound((int32_t) Cal::height * 65536, Cal::TS_LR_Y - Cal::TS_UL_Y);
+  static constexpr int32_t INV_SCALE_X =
+    divRound((int32_t) (Cal::TS_LR_X - Cal::TS_UL_X) * 65536, Cal::width);
+  static constexpr int32_t INV_SCALE_Y =
+    divRound((int32_t) (Cal::TS_LR_Y - Cal::TS_UL_Y) * 65536, Cal::height);
+
+  // Return v * scale in Q16. When scale fits in 16 bits (it does for the
+  // touchscreen to display scales of displays under 1500 pixels or so across),
+  // the multiply is 16x16 bits, a single hardware multiply sequence on AVR.
+  static constexpr int32_t mul(int16_t v, int32_t scale) {
+    return((scale >= -32768 && scale <= 32767) ?
+      (int32_t) v * (int16_t) scale : (int32_t) v * scale);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Map a touchscreen x-coordinate to a display x-coordinate.
+    @param  TSx   Touchscreen x-coordinate.
+    @returns  Display x-coordinate.
+  */
+  /**************************************************************************/
+  static constexpr int16_t displayX(int16_t TSx) {
+    return((int16_t) ((mul(TSx - Cal::TS_UL_X, SCALE_X) + 32768) >> 16));
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Map a touchscreen y-coordinate to a display y-coordinate.
+    @param  TSy   Touchscreen y-coordinate.
+    @returns  Display y-coordinate.
+  */
+  /**************************************************************************/
+  static constexpr int16_t displayY(int16_t TSy) {
+    return((int16_t) ((mul(TSy - Cal::TS_UL_Y, SCALE_Y) + 32768) >> 16));
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Map a display x-coordinate to a touchscreen x-coordinate.
+    @param  x   Display x-coordinate, within a few display widths of the
+                display.
+    @returns  Touchscreen x-coordinate.
+  */
+  /**************************************************************************/
+  static constexpr int16_t touchX(int16_t x) {
+    return((int16_t) (Cal::TS_UL_X + ((mul(x, INV_SCALE_X) + 32768) >> 16)));
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Map a display y-coordinate to a touchscreen y-coordinate.
+    @param  y   Display y-coordinate, within a few display heights of the
+                display.
+    @returns  Touchscreen y-coordinate.
+  */
+  /**************************************************************************/
+  static constexpr int16_t touchY(int16_t y) {
+    return((int16_t) (Cal::TS_UL_Y + ((mul(y, INV_SCALE_Y) + 32768) >> 16)));
+  }
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class template TS_DisplayT provides touch/release events and
+            mapping between touchscreen and display coordinates like class
+            TS_Display, with its configuration fixed at compile time.
+  @param    Cal   Configuration struct, e.g. derived from TS_DefaultCal.
+  @param    TS    Touchscreen class, XPT2046_Touchscreen or an
+                  XPT2046_TouchscreenT type.
+*/
+/**************************************************************************/
+template <class Cal, class TS = XPT2046_Touchscreen>
+class TS_DisplayT {
+
+private:
+
+  typedef TS_FixedMap<Cal> Map;
+
+  // The touchscreen object associated with the class instance using begin().
+  TS* _ts;
+
+  // true if last touchscreen event was a touch event, false if release event.
+  bool _lastEventWasTouch;
+
+  // Timer for debouncing.
+  uint32_t _msTime;
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+  */
+  /**************************************************************************/
+  TS_DisplayT() : _ts(nullptr), _lastEventWasTouch(false), _msTime(0) {}
+
+  /**************************************************************************/
+  /*!
+    @brief  Class instance initialization function.
+    @param  ts    Pointer to the instance of the touchscreen object.
+    @note   The touchscreen pressure thresholds are set from Cal.
+  */
+  /**************************************************************************/
+  void begin(TS* ts) {
+    _ts = ts;
+    _ts->setThresholds(Cal::Z_Threshold, Cal::Z_Threshold_Int);
+    _lastEventWasTouch = false;
+    _msTime = millis();
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Get current touchscreen state OR last touch or release event, as
+            TS_Display::getTouchEvent() does.
+    @param  x     Reference to a variable in which to return the display
+                  x-coordinate corresponding to current touch position if any.
+    @param  y     Reference to a variable in which to return the display
+                  y-coordinate corresponding to current touch position if any.
+    @param  pres  Reference to a variable in which to return the current touch
+                  pressure, 0 if none.
+    @param  px    nullptr if not used, else a pointer to a variable to receive
+                  the current touchscreen x-coordinate.
+    @param  py    nullptr if not used, else a pointer to a variable to receive
+                  the current touchscreen y-coordinate.
+    @returns  A TS_ constant indicating a touch or release event if any, else
+              indicating the current touch state.
+  */
+  /**************************************************************************/
+  eTouchEvent getTouchEvent(int16_t& x, int16_t& y, int16_t& pres,
+      int16_t* px=nullptr, int16_t* py=nullptr) {
+
+    eTouchEvent ret = TS_UNCERTAIN;
+    TS_Point p = _ts->getPoint();
+
+    if (px != nullptr)
+      *px = p.x;
+    if (py != nullptr)
+      *py = p.y;
+
+    x = Map::displayX(p.x);
+    y = Map::displayY(p.y);
+    pres = p.z;
+
+    bool currentTSeventIsTouch = _lastEventWasTouch;
+    if (pres >= Cal::minTouchPres) {
+      currentTSeventIsTouch = true;
+      ret = TS_TOUCH_PRESENT;
+    } else if (pres <= Cal::maxReleasePres) {
+      currentTSeventIsTouch = false;
+      ret = TS_NO_TOUCH;
+    }
+
+    // If no change from last detected event, restart debounce timer.
+    uint32_t now = millis();
+    if (_lastEventWasTouch == currentTSeventIsTouch) {
+      _msTime = now;
+      return(ret);
+    }
+
+    // A change since the last event has occurred, don't register it until
+    // debounce timer has expired.
+    if (now - _msTime < Cal::debounceMS_TR)
+      return(ret);
+
+    _msTime = now;
+    _lastEventWasTouch = currentTSeventIsTouch;
+    return(currentTSeventIsTouch ? TS_TOUCH_EVENT : TS_RELEASE_EVENT);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Map a touchscreen point (TSx, TSy) to a display point (x, y).
+    @param  TSx   Touchscreen x-coordinate to map.
+    @param  TSy   Touchscreen y-coordinate to map.
+    @param  x     Pointer to variable to receive display x-coordinate.
+    @param  y     Pointer to variable to receive display y-coordinate.
+  */
+  /**************************************************************************/
+  static void mapTStoDisplay(int16_t TSx, int16_t TSy, int16_t* x,
+      int16_t* y) {
+    *x = Map::displayX(TSx);
+    *y = Map::displayY(TSy);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Reverse map a display point (x, y) to a touchscreen point (TSx, TSy).
+    @param  x     Display x-coordinate to map.
+    @param  y     Display y-coordinate to map.
+    @param  TSx   Pointer to variable to receive touchscreen x-coordinate.
+    @param  TSy   Pointer to variable to receive touchscreen y-coordinate.
+  */
+  /**************************************************************************/
+  static void mapDisplayToTS(int16_t x, int16_t y, int16_t* TSx,
+      int16_t* TSy) {
+    *TSx = Map::touchX(x);
+    *TSy = Map::touchY(y);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the display width, from Cal.
+    @returns  Display width in pixels.
+  */
+  /**************************************************************************/
+  static constexpr int16_t width() { return(Cal::width); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the display height, from Cal.
+    @returns  Display height in pixels.
+  */
+  /**************************************************************************/
+  static constexpr int16_t height() { return(Cal::height); }
+};
+
+#endif // TS_DisplayT_h
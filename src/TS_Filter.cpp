@@ -0,0 +1,142 @@
+/*
+  TS_Filter.cpp - Filters reducing several oversampled touchscreen coordinate
+  readings to a single value.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Arduino.h>
+#include <TS_Filter.h>
+
+static int16_t besttwoavg( int16_t x , int16_t y , int16_t z ) {
+  int16_t da, db, dc;
+  int16_t reta = 0;
+  if ( x > y ) da = x - y; else da = y - x;
+  if ( x > z ) db = x - z; else db = z - x;
+  if ( z > y ) dc = z - y; else dc = y - z;
+
+  if ( da <= db && da <= dc ) reta = (x + y) >> 1;
+  else if ( db <= da && db <= dc ) reta = (x + z) >> 1;
+  else reta = (y + z) >> 1;   //    else if ( dc <= da && dc <= db ) reta = (x + y) >> 1;
+
+  return (reta);
+}
+
+/**************************************************************************/
+int16_t TS_filterBestTwoAvg(const int16_t* v, uint8_t n) {
+  if (n == 3)
+    return(besttwoavg(v[0], v[1], v[2]));
+  if (n < 2)
+    return(v[0]);
+  uint8_t bi = 0, bj = 1;
+  int16_t best = abs(v[0] - v[1]);
+  for (uint8_t i = 0; i < n - 1; i++)
+    for (uint8_t j = i + 1; j < n; j++) {
+      int16_t d = abs(v[i] - v[j]);
+      if (d < best) {
+        best = d;
+        bi = i;
+        bj = j;
+      }
+    }
+  return((v[bi] + v[bj]) >> 1);
+}
+
+/**************************************************************************/
+// Sort n readings in place. Insertion sort, since n is small.
+static void sortReadings(int16_t* v, uint8_t n) {
+  for (uint8_t i = 1; i < n; i++) {
+    int16_t t = v[i];
+    uint8_t j = i;
+    for (; j > 0 && v[j-1] > t; j--)
+      v[j] = v[j-1];
+    v[j] = t;
+  }
+}
+
+/**************************************************************************/
+int16_t TS_filterMedian(int16_t* v, uint8_t n) {
+  sortReadings(v, n);
+  if (n & 1)
+    return(v[n/2]);
+  return((v[n/2 - 1] + v[n/2]) >> 1);
+}
+
+/**************************************************************************/
+int16_t TS_filterTrimmedMean(int16_t* v, uint8_t n) {
+  sortReadings(v, n);
+  uint8_t trim = n / 4;
+  int32_t sum = 0;
+  for (uint8_t i = trim; i < n - trim; i++)
+    sum += v[i];
+  return((int16_t)(sum / (n - 2*trim)));
+}
+
+/**************************************************************************/
+bool TS_filterRansac(const int16_t* v, uint8_t n, int16_t* result) {
+  uint8_t bestCount = 0;
+  int32_t bestSum = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    uint8_t count = 0;
+    int32_t sum = 0;
+    for (uint8_t j = 0; j < n; j++)
+      if (abs(v[j] - v[i]) <= TS_RANSAC_TOLERANCE) {
+        count++;
+        sum += v[j];
+      }
+    if (count > bestCount) {
+      bestCount = count;
+      bestSum = sum;
+    }
+  }
+  if (2*bestCount < n)
+    return(false);
+  *result = (int16_t)(bestSum / bestCount);
+  return(true);
+}
+
+/**************************************************************************/
+bool TS_filter(eTS_Filter filter, int16_t* v, uint8_t n, int16_t* result) {
+  switch (filter) {
+  case TS_FILTER_MEDIAN:
+    *result = TS_filterMedian(v, n);
+    break;
+  case TS_FILTER_TRIMMED_MEAN:
+    *result = TS_filterTrimmedMean(v, n);
+    break;
+  case TS_FILTER_RANSAC:
+    return(TS_filterRansac(v, n, result));
+  default: // TS_FILTER_BEST_TWO_AVG
+    *result = TS_filterBestTwoAvg(v, n);
+    break;
+  }
+  return(true);
+}
+
+// -------------------------------------------------------------------------
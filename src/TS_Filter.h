@@ -0,0 +1,162 @@
+/*
+  TS_Filter.h - Defines enum eTS_Filter and function TS_filter(), which reduce
+  several oversampled touchscreen coordinate readings to a single value.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  Each touchscreen sample reads the X and Y coordinates several times, and a
+  filter reduces those readings to one X and one Y value, rejecting spikes
+  caused by electrical noise (for example from display backlight PWM). The
+  number of readings per sample is set with the touchscreen's setFilter()
+  function, up to XPT2046_MAX_SAMPLES. More readings take more SPI time but
+  reject noise better.
+
+  The filters are:
+
+    TS_FILTER_BEST_TWO_AVG  Average of the two readings closest to each other.
+                            This is the original filter and the default, with
+                            three readings.
+
+    TS_FILTER_MEDIAN        Median of the readings.
+
+    TS_FILTER_TRIMMED_MEAN  Mean of the readings after discarding the lowest
+                            and highest quarter of them.
+
+    TS_FILTER_RANSAC        Consensus filter: the reading with the most other
+                            readings within TS_RANSAC_TOLERANCE of it is taken
+                            as the model, and the mean of those inliers is the
+                            result. If fewer than half of the readings agree,
+                            the whole sample is rejected as noise. With the
+                            small reading counts used here every reading is
+                            tried as the model, so the result is
+                            deterministic.
+*/
+/**************************************************************************/
+
+#ifndef TS_Filter_h
+#define TS_Filter_h
+
+#include <Arduino.h>
+
+// Maximum number of X/Y readings per sample. This sizes the reading arrays,
+// which are on the stack during a sample.
+#ifndef XPT2046_MAX_SAMPLES
+#define XPT2046_MAX_SAMPLES 8
+#endif
+
+// Default number of X/Y readings per sample.
+#define XPT2046_DEF_SAMPLES 3
+
+// Maximum distance between two readings for TS_FILTER_RANSAC to consider them
+// to agree, in touchscreen units.
+#ifndef TS_RANSAC_TOLERANCE
+#define TS_RANSAC_TOLERANCE 24
+#endif
+
+/**************************************************************************/
+/*!
+  @brief    Enum eTS_Filter selects the filter that reduces the X or Y readings
+            of one sample to a single value.
+*/
+/**************************************************************************/
+typedef enum _eTS_Filter {
+  TS_FILTER_BEST_TWO_AVG,   /*! Average of the closest two readings. */
+  TS_FILTER_MEDIAN,         /*! Median of the readings. */
+  TS_FILTER_TRIMMED_MEAN,   /*! Mean of the middle half of the readings. */
+  TS_FILTER_RANSAC          /*! Mean of the largest agreeing set of readings. */
+} eTS_Filter;
+
+/**************************************************************************/
+/*!
+  @brief    Reduce n readings to a single value using a filter.
+  @param    filter  The filter to use.
+  @param    v       Array of n readings. The array may be reordered.
+  @param    n       Number of readings, 1 to XPT2046_MAX_SAMPLES.
+  @param    result  Pointer to variable to receive the filtered value.
+  @returns  true if successful, false if the filter rejected the readings as
+            noise (only TS_FILTER_RANSAC does this).
+*/
+/**************************************************************************/
+extern bool TS_filter(eTS_Filter filter, int16_t* v, uint8_t n,
+  int16_t* result);
+
+/**************************************************************************/
+/*!
+  @brief    Average of the two readings closest to each other, the filter
+            called by TS_filter() for TS_FILTER_BEST_TWO_AVG. This and the
+            filter functions below may be called directly when the filter is
+            known at compile time.
+  @param    v       Array of n readings.
+  @param    n       Number of readings, 1 to XPT2046_MAX_SAMPLES.
+  @returns  The filtered value.
+*/
+/**************************************************************************/
+extern int16_t TS_filterBestTwoAvg(const int16_t* v, uint8_t n);
+
+/**************************************************************************/
+/*!
+  @brief    Median of the readings, the filter called by TS_filter() for
+            TS_FILTER_MEDIAN.
+  @param    v       Array of n readings. The array is sorted.
+  @param    n       Number of readings, 1 to XPT2046_MAX_SAMPLES.
+  @returns  The filtered value.
+*/
+/**************************************************************************/
+extern int16_t TS_filterMedian(int16_t* v, uint8_t n);
+
+/**************************************************************************/
+/*!
+  @brief    Mean of the readings after discarding the lowest and highest
+            quarter of them, the filter called by TS_filter() for
+            TS_FILTER_TRIMMED_MEAN.
+  @param    v       Array of n readings. The array is sorted.
+  @param    n       Number of readings, 1 to XPT2046_MAX_SAMPLES.
+  @returns  The filtered value.
+*/
+/**************************************************************************/
+extern int16_t TS_filterTrimmedMean(int16_t* v, uint8_t n);
+
+/**************************************************************************/
+/*!
+  @brief    Mean of the largest set of readings agreeing within
+            TS_RANSAC_TOLERANCE, the filter called by TS_filter() for
+            TS_FILTER_RANSAC.
+  @param    v       Array of n readings.
+  @param    n       Number of readings, 1 to XPT2046_MAX_SAMPLES.
+  @param    result  Pointer to variable to receive the filtered value.
+  @returns  true if successful, false if fewer than half of the readings
+            agree, in which case they are rejected as noise and *result is
+            not changed.
+*/
+/**************************************************************************/
+extern bool TS_filterRansac(const int16_t* v, uint8_t n, int16_t* result);
+
+#endif // TS_Filter_h
@@ -0,0 +1,225 @@
+/*
+  TS_Gesture.cpp - Gesture recognition from touch, release, and move events.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Arduino.h>
+#include <TS_Gesture.h>
+
+// Default gesture thresholds.
+#define DEF_TAP_MAX_MOVE      10
+#define DEF_TAP_MAX_MS        250
+#define DEF_DOUBLE_TAP_MS     300
+#define DEF_LONG_PRESS_MS     600
+#define DEF_SWIPE_MIN_DIST    30
+#define DEF_SWIPE_MIN_SPEED   400
+
+// Moves further apart in time than this restart the velocity estimate.
+#define VELOCITY_MAX_GAP_US   100000
+
+/**************************************************************************/
+TS_Gesture::TS_Gesture() {
+  _params.tapMaxMove = DEF_TAP_MAX_MOVE;
+  _params.tapMaxMS = DEF_TAP_MAX_MS;
+  _params.doubleTapMS = DEF_DOUBLE_TAP_MS;
+  _params.longPressMS = DEF_LONG_PRESS_MS;
+  _params.swipeMinDist = DEF_SWIPE_MIN_DIST;
+  _params.swipeMinSpeed = DEF_SWIPE_MIN_SPEED;
+  reset();
+}
+
+/**************************************************************************/
+void TS_Gesture::reset() {
+  _state = STATE_IDLE;
+  _startX = _startY = _lastX = _lastY = 0;
+  _startUs = _lastUs = 0;
+  _longPressed = false;
+  _vx = _vy = 0;
+  _tapPending = false;
+  _tapX = _tapY = 0;
+  _tapUs = 0;
+  _head = _count = 0;
+}
+
+/**************************************************************************/
+void TS_Gesture::push(eTS_Gesture type, int16_t x, int16_t y, int16_t dx,
+    int16_t dy, uint32_t us, eTS_SwipeDir dir) {
+  TS_GestureEvent* g;
+  uint8_t last = (_head + _count - 1) % TS_GESTURE_QUEUE_SIZE;
+  if (type == TS_GESTURE_DRAG && _count > 0 && _queue[last].type == TS_GESTURE_DRAG) {
+    // Merge with the unread drag before it.
+    g = &_queue[last];
+    dx += g->dx;
+    dy += g->dy;
+  } else {
+    if (_count == TS_GESTURE_QUEUE_SIZE) {
+      // Drop the oldest gesture.
+      _head = (_head + 1) % TS_GESTURE_QUEUE_SIZE;
+      _count--;
+    }
+    g = &_queue[(_head + _count) % TS_GESTURE_QUEUE_SIZE];
+    _count++;
+  }
+  g->type = type;
+  g->x = x;
+  g->y = y;
+  g->dx = dx;
+  g->dy = dy;
+  g->vx = _vx;
+  g->vy = _vy;
+  g->dir = dir;
+  g->us = us;
+}
+
+/**************************************************************************/
+void TS_Gesture::updateVelocity(int16_t x, int16_t y, uint32_t us) {
+  uint32_t dt = us - _lastUs;
+  if (dt == 0)
+    return;
+  if (dt > VELOCITY_MAX_GAP_US) {
+    _vx = _vy = 0;
+    return;
+  }
+  // Exponential average of the instantaneous velocity, weight 1/2.
+  int32_t vx = (int32_t) ((int32_t) (x - _lastX) * 1000000LL / dt);
+  int32_t vy = (int32_t) ((int32_t) (y - _lastY) * 1000000LL / dt);
+  _vx = (_vx + vx) / 2;
+  _vy = (_vy + vy) / 2;
+}
+
+/**************************************************************************/
+void TS_Gesture::addEvent(const TS_Event& ev) {
+  checkTime(ev.us);
+
+  switch (ev.type) {
+
+  case TS_TOUCH_EVENT:
+    _state = STATE_DOWN;
+    _startX = _lastX = ev.x;
+    _startY = _lastY = ev.y;
+    _startUs = _lastUs = ev.us;
+    _longPressed = false;
+    _vx = _vy = 0;
+    break;
+
+  case TS_MOVE_EVENT:
+    if (_state == STATE_IDLE)
+      break;
+    updateVelocity(ev.x, ev.y, ev.us);
+    if (_state == STATE_DOWN) {
+      if (abs(ev.x - _startX) <= _params.tapMaxMove &&
+          abs(ev.y - _startY) <= _params.tapMaxMove)
+        break;
+      _state = STATE_DRAG;
+      push(TS_GESTURE_DRAG_START, _startX, _startY, 0, 0, ev.us);
+    }
+    push(TS_GESTURE_DRAG, ev.x, ev.y, ev.x - _lastX, ev.y - _lastY, ev.us);
+    _lastX = ev.x;
+    _lastY = ev.y;
+    _lastUs = ev.us;
+    break;
+
+  case TS_RELEASE_EVENT:
+    if (_state == STATE_DRAG) {
+      int16_t dx = _lastX - _startX, dy = _lastY - _startY;
+      // Events come only when the position changes, so a drag that stopped
+      // and was held before release has no velocity left.
+      if (ev.us - _lastUs > VELOCITY_MAX_GAP_US)
+        _vx = _vy = 0;
+      push(TS_GESTURE_DRAG_END, _lastX, _lastY, dx, dy, ev.us);
+      int32_t ax = abs(_vx), ay = abs(_vy);
+      if ((abs(dx) >= _params.swipeMinDist || abs(dy) >= _params.swipeMinDist) &&
+          (ax >= _params.swipeMinSpeed || ay >= _params.swipeMinSpeed)) {
+        eTS_SwipeDir dir;
+        if (ax >= ay)
+          dir = (_vx < 0) ? TS_SWIPE_LEFT : TS_SWIPE_RIGHT;
+        else
+          dir = (_vy < 0) ? TS_SWIPE_UP : TS_SWIPE_DOWN;
+        push(TS_GESTURE_SWIPE, _lastX, _lastY, dx, dy, ev.us, dir);
+      }
+    } else if (_state == STATE_DOWN && !_longPressed &&
+        ev.us - _startUs <= (uint32_t) _params.tapMaxMS * 1000) {
+      if (_tapPending && abs(_startX - _tapX) <= 2*_params.tapMaxMove &&
+          abs(_startY - _tapY) <= 2*_params.tapMaxMove) {
+        _tapPending = false;
+        push(TS_GESTURE_DOUBLE_TAP, _startX, _startY, 0, 0, ev.us);
+      } else {
+        // A pending tap too far from this one is reported before it is
+        // replaced.
+        if (_tapPending)
+          push(TS_GESTURE_TAP, _tapX, _tapY, 0, 0, _tapUs);
+        if (_params.doubleTapMS == 0) {
+          _tapPending = false;
+          push(TS_GESTURE_TAP, _startX, _startY, 0, 0, ev.us);
+        } else {
+          _tapPending = true;
+          _tapX = _startX;
+          _tapY = _startY;
+          _tapUs = ev.us;
+        }
+      }
+    }
+    _state = STATE_IDLE;
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**************************************************************************/
+void TS_Gesture::checkTime(uint32_t us) {
+  if (_tapPending && us - _tapUs > (uint32_t) _params.doubleTapMS * 1000) {
+    _tapPending = false;
+    push(TS_GESTURE_TAP, _tapX, _tapY, 0, 0, _tapUs);
+  }
+  if (_state == STATE_DOWN && !_longPressed && _params.longPressMS != 0 &&
+      us - _startUs >= (uint32_t) _params.longPressMS * 1000) {
+    _longPressed = true;
+    if (_tapPending) {
+      _tapPending = false;
+      push(TS_GESTURE_TAP, _tapX, _tapY, 0, 0, _tapUs);
+    }
+    push(TS_GESTURE_LONG_PRESS, _startX, _startY, 0, 0,
+      _startUs + (uint32_t) _params.longPressMS * 1000);
+  }
+}
+
+/**************************************************************************/
+bool TS_Gesture::getGesture(TS_GestureEvent& g) {
+  if (_count == 0)
+    return(false);
+  g = _queue[_head];
+  _head = (_head + 1) % TS_GESTURE_QUEUE_SIZE;
+  _count--;
+  return(true);
+}
+
+// -------------------------------------------------------------------------
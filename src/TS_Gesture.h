@@ -0,0 +1,264 @@
+/*
+  TS_Gesture.h - Defines class TS_Gesture, which recognizes taps, double taps,
+  long presses, drags, and swipes from the events returned by
+  TS_Display::pollEvent().
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  TS_Gesture is fed the touch, release, and move events of TS_Display's event
+  queue. Those carry display coordinates, so the gesture thresholds are in
+  display pixels and already reflect the touchscreen calibration, and micros()
+  timestamps, so gestures are timed by when the samples were taken rather than
+  by when the application gets around to handling them. All state is kept in
+  the object, which has a fixed size and never allocates memory.
+
+  The gestures are:
+
+    TS_GESTURE_TAP          Short touch that does not move. If double taps are
+                            enabled, it is reported only once the double tap
+                            time has passed without a second tap.
+    TS_GESTURE_DOUBLE_TAP   Second tap near the first within the double tap
+                            time.
+    TS_GESTURE_LONG_PRESS   Touch held without moving for the long press time,
+                            reported while still held.
+    TS_GESTURE_DRAG_START   Touch moved beyond the tap distance. Position is
+                            where the touch started.
+    TS_GESTURE_DRAG         Each move after that, with the motion since the
+                            previous one.
+    TS_GESTURE_DRAG_END     The touch of a drag was released.
+    TS_GESTURE_SWIPE        Drag released while moving fast enough, reported
+                            right after TS_GESTURE_DRAG_END with the direction.
+
+  The velocity of the touch is estimated incrementally on every move event, so
+  the swipe direction and speed are known as soon as the touch is released.
+
+  Usage:
+
+    TS_Gesture gestures;
+    ...
+    TS_Event ev;
+    while (ts_display->pollEvent(ev))
+      gestures.addEvent(ev);
+    gestures.checkTime(micros());
+    TS_GestureEvent g;
+    while (gestures.getGesture(g)) {
+      ...
+    }
+*/
+/**************************************************************************/
+
+#ifndef TS_Gesture_h
+#define TS_Gesture_h
+
+#include <Arduino.h>
+#include <TS_Display.h>
+
+// Capacity of the queue of recognized gestures.
+#ifndef TS_GESTURE_QUEUE_SIZE
+#define TS_GESTURE_QUEUE_SIZE 4
+#endif
+
+/**************************************************************************/
+/*!
+  @brief    Enum eTS_Gesture identifies a gesture.
+*/
+/**************************************************************************/
+typedef enum _eTS_Gesture {
+  TS_GESTURE_TAP,         /*! Short touch without movement. */
+  TS_GESTURE_DOUBLE_TAP,  /*! Two taps in quick succession. */
+  TS_GESTURE_LONG_PRESS,  /*! Touch held without movement. */
+  TS_GESTURE_DRAG_START,  /*! Touch started moving. */
+  TS_GESTURE_DRAG,        /*! Touch moved. */
+  TS_GESTURE_DRAG_END,    /*! Moving touch released. */
+  TS_GESTURE_SWIPE        /*! Moving touch released at speed. */
+} eTS_Gesture;
+
+/**************************************************************************/
+/*!
+  @brief    Enum eTS_SwipeDir gives the direction of a swipe on the display.
+*/
+/**************************************************************************/
+typedef enum _eTS_SwipeDir {
+  TS_SWIPE_NONE,
+  TS_SWIPE_LEFT,
+  TS_SWIPE_RIGHT,
+  TS_SWIPE_UP,
+  TS_SWIPE_DOWN
+} eTS_SwipeDir;
+
+/**************************************************************************/
+/*!
+  @brief    Struct TS_GestureEvent holds one recognized gesture.
+*/
+/**************************************************************************/
+struct TS_GestureEvent {
+  eTS_Gesture type;
+  int16_t x, y;       // Display position
+  int16_t dx, dy;     // Motion: since last drag event for TS_GESTURE_DRAG,
+                      // from drag start for TS_GESTURE_DRAG_END/SWIPE
+  int32_t vx, vy;     // Velocity at release in pixels/s (DRAG_END, SWIPE)
+  eTS_SwipeDir dir;   // Direction of TS_GESTURE_SWIPE
+  uint32_t us;        // micros() time of the gesture
+};
+
+/**************************************************************************/
+/*!
+  @brief    Struct TS_GestureParams holds the thresholds used to recognize
+            gestures. Distances are in display pixels.
+*/
+/**************************************************************************/
+struct TS_GestureParams {
+  int16_t tapMaxMove;       // Movement beyond which a touch is a drag
+  uint16_t tapMaxMS;        // Longest touch that is a tap
+  uint16_t doubleTapMS;     // Longest time between taps of a double tap, 0
+                            // to not detect double taps
+  uint16_t longPressMS;     // Time a touch must be held for a long press, 0
+                            // to not detect long presses
+  int16_t swipeMinDist;     // Shortest drag that is a swipe
+  int32_t swipeMinSpeed;    // Slowest release speed of a swipe, pixels/s
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_Gesture recognizes gestures from touch, release, and move
+            events.
+*/
+/**************************************************************************/
+class TS_Gesture {
+
+private:
+
+  // Gesture recognition state.
+  typedef enum _eState {
+    STATE_IDLE,   // Not touched
+    STATE_DOWN,   // Touched, not moved beyond tapMaxMove
+    STATE_DRAG    // Touched and dragging
+  } eState;
+
+  TS_GestureParams _params;
+  eState _state;
+
+  // Position and time where the touch started, last position and time, and
+  // whether a long press was reported for this touch.
+  int16_t _startX, _startY;
+  uint32_t _startUs;
+  int16_t _lastX, _lastY;
+  uint32_t _lastUs;
+  bool _longPressed;
+
+  // Velocity estimate, pixels/s.
+  int32_t _vx, _vy;
+
+  // A tap waiting to see if it becomes a double tap.
+  bool _tapPending;
+  int16_t _tapX, _tapY;
+  uint32_t _tapUs;
+
+  // Queue of recognized gestures.
+  TS_GestureEvent _queue[TS_GESTURE_QUEUE_SIZE];
+  uint8_t _head, _count;
+
+  // Queue a gesture.
+  void push(eTS_Gesture type, int16_t x, int16_t y, int16_t dx, int16_t dy,
+    uint32_t us, eTS_SwipeDir dir = TS_SWIPE_NONE);
+
+  // Update the velocity estimate with a move to (x,y) at time us.
+  void updateVelocity(int16_t x, int16_t y, uint32_t us);
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor, using the default thresholds.
+  */
+  /**************************************************************************/
+  TS_Gesture();
+
+  /**************************************************************************/
+  /*!
+    @brief  Set the gesture thresholds.
+    @param  params  The new thresholds.
+  */
+  /**************************************************************************/
+  void setParams(const TS_GestureParams& params) { _params = params; }
+
+  /**************************************************************************/
+  /*!
+    @brief  Get the gesture thresholds.
+    @param  params  Reference to variable to receive the thresholds.
+  */
+  /**************************************************************************/
+  void getParams(TS_GestureParams& params) { params = _params; }
+
+  /**************************************************************************/
+  /*!
+    @brief  Feed one event from TS_Display::pollEvent() to the recognizer.
+    @param  ev  The event.
+  */
+  /**************************************************************************/
+  void addEvent(const TS_Event& ev);
+
+  /**************************************************************************/
+  /*!
+    @brief  Recognize gestures that depend on time passing without an event,
+            i.e. a long press, or a tap that can no longer become a double tap.
+    @param  us  Current micros() time.
+  */
+  /**************************************************************************/
+  void checkTime(uint32_t us);
+
+  /**************************************************************************/
+  /*!
+    @brief  Get the next recognized gesture.
+    @param  g   Reference to variable to receive the gesture.
+    @returns  true if a gesture was returned, false if there are none.
+  */
+  /**************************************************************************/
+  bool getGesture(TS_GestureEvent& g);
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the current velocity estimate of the touch.
+    @param  vx  Pointer to variable to receive x velocity in pixels/s.
+    @param  vy  Pointer to variable to receive y velocity in pixels/s.
+  */
+  /**************************************************************************/
+  void velocity(int32_t* vx, int32_t* vy) { *vx = _vx; *vy = _vy; }
+
+  /**************************************************************************/
+  /*!
+    @brief  Discard all state and queued gestures.
+  */
+  /**************************************************************************/
+  void reset();
+};
+
+#endif // TS_Gesture_h
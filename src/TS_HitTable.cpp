@@ -0,0 +1,151 @@
+/*
+  TS_HitTable.cpp - Table of display regions with a uniform grid index.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Arduino.h>
+#include <TS_HitTable.h>
+
+/**************************************************************************/
+bool TS_HitTable::add(uint8_t id, int16_t x, int16_t y, int16_t w, int16_t h) {
+  if (_count >= _capacity)
+    return(false);
+  TS_HitRegion& r = _regions[_count++];
+  r.x = x;
+  r.y = y;
+  r.w = w;
+  r.h = h;
+  r.id = id;
+  _dirty = true;
+  return(true);
+}
+
+/**************************************************************************/
+// Clamp display coordinate v to 0..size-1 and convert it to a grid column or
+// row.
+static uint8_t gridCell(int16_t v, int16_t size, uint8_t shift) {
+  if (v < 0)
+    v = 0;
+  else if (v >= size)
+    v = size - 1;
+  return((uint8_t)(v >> shift));
+}
+
+/**************************************************************************/
+void TS_HitTable::cellRange(const TS_HitRegion& r, uint8_t* c0, uint8_t* c1,
+    uint8_t* r0, uint8_t* r1) {
+  *c0 = gridCell(r.x, _width, _shiftX);
+  *c1 = gridCell(r.x + r.w - 1, _width, _shiftX);
+  *r0 = gridCell(r.y, _height, _shiftY);
+  *r1 = gridCell(r.y + r.h - 1, _height, _shiftY);
+}
+
+/**************************************************************************/
+// Return smallest shift making (size-1) >> shift less than cells.
+static uint8_t gridShift(int16_t size, uint8_t cells) {
+  uint8_t shift = 0;
+  while (((size - 1) >> shift) >= cells)
+    shift++;
+  return(shift);
+}
+
+/**************************************************************************/
+bool TS_HitTable::build(int16_t width, int16_t height) {
+  _width = (width > 0) ? width : 1;
+  _height = (height > 0) ? height : 1;
+  _shiftX = gridShift(_width, TS_HIT_GRID_COLS);
+  _shiftY = gridShift(_height, TS_HIT_GRID_ROWS);
+
+  // Count the regions overlapping each cell into _cellStart[c+1].
+  for (uint16_t c = 0; c <= TS_HIT_GRID_CELLS; c++)
+    _cellStart[c] = 0;
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < _count; i++) {
+    const TS_HitRegion& r = _regions[i];
+    if (r.w <= 0 || r.h <= 0 || r.x >= _width || r.y >= _height ||
+        r.x + r.w <= 0 || r.y + r.h <= 0)
+      continue;
+    uint8_t c0, c1, r0, r1;
+    cellRange(r, &c0, &c1, &r0, &r1);
+    for (uint8_t row = r0; row <= r1; row++)
+      for (uint8_t col = c0; col <= c1; col++)
+        _cellStart[row * TS_HIT_GRID_COLS + col + 1]++;
+    total += (uint32_t) (c1 - c0 + 1) * (r1 - r0 + 1);
+  }
+  _dirty = false;
+  _indexed = false;
+  if (total > _entryCap)
+    return(false);
+
+  // Make _cellStart[c+1] the start of cell c, then fill each cell's entries
+  // advancing _cellStart[c+1] to its end, which is the start of cell c+1.
+  for (uint16_t c = 1; c < TS_HIT_GRID_CELLS; c++)
+    _cellStart[c+1] += _cellStart[c];
+  for (uint16_t c = TS_HIT_GRID_CELLS; c > 0; c--)
+    _cellStart[c] = _cellStart[c-1];
+  for (uint8_t i = 0; i < _count; i++) {
+    const TS_HitRegion& r = _regions[i];
+    if (r.w <= 0 || r.h <= 0 || r.x >= _width || r.y >= _height ||
+        r.x + r.w <= 0 || r.y + r.h <= 0)
+      continue;
+    uint8_t c0, c1, r0, r1;
+    cellRange(r, &c0, &c1, &r0, &r1);
+    for (uint8_t row = r0; row <= r1; row++)
+      for (uint8_t col = c0; col <= c1; col++)
+        _entries[_cellStart[row * TS_HIT_GRID_COLS + col + 1]++] = i;
+  }
+  _indexed = true;
+  return(true);
+}
+
+/**************************************************************************/
+const TS_HitRegion* TS_HitTable::find(int16_t x, int16_t y) {
+  if (_dirty && _width > 0)
+    build(_width, _height);
+
+  if (!_indexed) {
+    for (uint8_t i = _count; i > 0; i--)
+      if (inside(_regions[i-1], x, y))
+        return(&_regions[i-1]);
+    return(nullptr);
+  }
+
+  if (x < 0 || y < 0 || x >= _width || y >= _height)
+    return(nullptr);
+  uint16_t c = (uint16_t) (y >> _shiftY) * TS_HIT_GRID_COLS + (x >> _shiftX);
+  for (uint16_t i = _cellStart[c+1]; i > _cellStart[c]; i--) {
+    const TS_HitRegion& r = _regions[_entries[i-1]];
+    if (inside(r, x, y))
+      return(&r);
+  }
+  return(nullptr);
+}
+
+// -------------------------------------------------------------------------
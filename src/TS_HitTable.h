@@ -0,0 +1,256 @@
+/*
+  TS_HitTable.h - Defines struct TS_HitRegion and classes TS_HitTable and
+  TS_HitRegions, a table of rectangular display regions indexed by a uniform
+  grid, so the region containing a touch is found without scanning them all.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  A user interface typically has many buttons or other touchable areas, and
+  finding the one containing a touch by testing each rectangle in turn can take
+  longer than reading the touchscreen, especially on 8-bit processors. A
+  TS_HitTable holds the rectangles, each with an id, and divides the display
+  into TS_HIT_GRID_COLS x TS_HIT_GRID_ROWS cells, listing for each cell the
+  regions that overlap it. The index is built once after the regions are added
+  (at layout time), and a lookup then tests only the few regions in one cell.
+  All storage is fixed in size and supplied by the TS_HitRegions template.
+
+  When a hit table is attached to a TS_Display object with attachHitTable(),
+  touch and release events carry the id of the region they are in: see
+  TS_Display::hitRegion() and the region member of TS_Event. Regions may
+  overlap; a region added later is considered to be on top of earlier ones.
+
+  Usage:
+
+    TS_HitRegions<80> buttons;
+    ...
+    buttons.add(BTN_OK, 10, 200, 60, 30);
+    buttons.add(BTN_CANCEL, 80, 200, 60, 30);
+    ts_display->attachHitTable(&buttons);
+    ...
+    if (ts_display->getTouchEvent(x, y, pres) == TS_TOUCH_EVENT)
+      switch (ts_display->hitRegion()) {
+        case BTN_OK: ...
+      }
+*/
+/**************************************************************************/
+
+#ifndef TS_HitTable_h
+#define TS_HitTable_h
+
+#include <Arduino.h>
+
+// Number of grid columns and rows of the index. More cells make lookups
+// faster, at the cost of two bytes per cell and more index entries.
+#ifndef TS_HIT_GRID_COLS
+#define TS_HIT_GRID_COLS  8
+#endif
+#ifndef TS_HIT_GRID_ROWS
+#define TS_HIT_GRID_ROWS  8
+#endif
+#define TS_HIT_GRID_CELLS (TS_HIT_GRID_COLS * TS_HIT_GRID_ROWS)
+
+// Region id meaning no region.
+#define TS_NO_REGION  0xFF
+
+/**************************************************************************/
+/*!
+  @brief    Struct TS_HitRegion holds one rectangular display region and its id.
+*/
+/**************************************************************************/
+struct TS_HitRegion {
+  int16_t x, y;       // Upper-left corner, display coordinates
+  int16_t w, h;       // Width and height in pixels
+  uint8_t id;         // Region id, not TS_NO_REGION
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_HitTable is a table of display regions with a grid index.
+            It does not own its storage; use class TS_HitRegions to declare a
+            table with storage of a given size.
+*/
+/**************************************************************************/
+class TS_HitTable {
+
+protected:
+
+  // Regions, capacity _capacity, _count in use.
+  TS_HitRegion* _regions;
+  uint8_t _capacity;
+  uint8_t _count;
+
+  // Grid index. The regions overlapping cell c are _regions[_entries[i]] for
+  // i from _cellStart[c] to _cellStart[c+1]-1, in the order they were added.
+  uint16_t* _cellStart;
+  uint8_t* _entries;
+  uint16_t _entryCap;
+
+  // Display size the index was built for, and shifts converting display
+  // coordinates to grid column and row.
+  int16_t _width, _height;
+  uint8_t _shiftX, _shiftY;
+
+  // True if regions changed since the index was built, and true if the index
+  // is valid (false if _entries was too small for it).
+  bool _dirty;
+  bool _indexed;
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  regions     Storage for capacity regions.
+    @param  capacity    Number of regions in regions, at most 255.
+    @param  cellStart   Storage for TS_HIT_GRID_CELLS+1 cell start indexes.
+    @param  entries     Storage for entryCap index entries.
+    @param  entryCap    Number of entries in entries.
+  */
+  /**************************************************************************/
+  TS_HitTable(TS_HitRegion* regions, uint8_t capacity, uint16_t* cellStart,
+      uint8_t* entries, uint16_t entryCap) : _regions(regions),
+      _capacity(capacity), _count(0), _cellStart(cellStart),
+      _entries(entries), _entryCap(entryCap), _width(0), _height(0),
+      _shiftX(0), _shiftY(0), _dirty(true), _indexed(false) {}
+
+  // Return the grid column and row ranges covered by region r.
+  void cellRange(const TS_HitRegion& r, uint8_t* c0, uint8_t* c1,
+    uint8_t* r0, uint8_t* r1);
+
+  // Return true if (x,y) is inside region r.
+  static bool inside(const TS_HitRegion& r, int16_t x, int16_t y) {
+    return(x >= r.x && x < r.x + r.w && y >= r.y && y < r.y + r.h);
+  }
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Add a region to the table.
+    @param  id  Region id, any value except TS_NO_REGION. Ids need not be
+                unique.
+    @param  x   Display x-coordinate of the upper-left corner.
+    @param  y   Display y-coordinate of the upper-left corner.
+    @param  w   Width in pixels.
+    @param  h   Height in pixels.
+    @returns  true if added, false if the table is full.
+    @note   The index is rebuilt by the next build() or hit() call.
+  */
+  /**************************************************************************/
+  bool add(uint8_t id, int16_t x, int16_t y, int16_t w, int16_t h);
+
+  /**************************************************************************/
+  /*!
+    @brief  Remove all regions.
+  */
+  /**************************************************************************/
+  void clear() { _count = 0; _dirty = true; }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the number of regions in the table.
+    @returns  Number of regions.
+  */
+  /**************************************************************************/
+  uint8_t count() { return(_count); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Build the grid index of the regions.
+    @param  width   Display width in pixels.
+    @param  height  Display height in pixels.
+    @returns  true if successful, false if there are too many index entries,
+              in which case hit() tests every region.
+    @note   TS_Display::attachHitTable() calls this with the display size.
+  */
+  /**************************************************************************/
+  bool build(int16_t width, int16_t height);
+
+  /**************************************************************************/
+  /*!
+    @brief  Find the region containing a display position.
+    @param  x   Display x-coordinate.
+    @param  y   Display y-coordinate.
+    @returns  The id of the topmost (last added) region containing (x,y), or
+              TS_NO_REGION if there is none.
+    @note   If regions were added since the index was built, it is rebuilt
+            first, for the same display size.
+  */
+  /**************************************************************************/
+  uint8_t hit(int16_t x, int16_t y) {
+    const TS_HitRegion* r = find(x, y);
+    return((r == nullptr) ? TS_NO_REGION : r->id);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Find the region containing a display position, as hit() does.
+    @param  x   Display x-coordinate.
+    @param  y   Display y-coordinate.
+    @returns  The topmost (last added) region containing (x,y), or nullptr if
+              there is none.
+  */
+  /**************************************************************************/
+  const TS_HitRegion* find(int16_t x, int16_t y);
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_HitRegions is a TS_HitTable with storage for N regions.
+  @param    N   Number of regions, at most 255.
+  @param    E   Number of index entries. Each region needs one entry for each
+                grid cell it overlaps, so the default allows an average of
+                four cells per region.
+*/
+/**************************************************************************/
+template <size_t N, size_t E = 4 * N>
+class TS_HitRegions : public TS_HitTable {
+
+  static_assert(N >= 1 && N < TS_NO_REGION,
+    "TS_HitRegions capacity must be 1 to 254");
+  static_assert(E >= N && E <= 65535,
+    "TS_HitRegions index size must be N to 65535");
+
+private:
+
+  TS_HitRegion _storage[N];
+  uint16_t _cellStorage[TS_HIT_GRID_CELLS + 1];
+  uint8_t _entryStorage[E];
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+  */
+  /**************************************************************************/
+  TS_HitRegions() : TS_HitTable(_storage, N, _cellStorage, _entryStorage, E) {}
+};
+
+#endif // TS_HitTable_h
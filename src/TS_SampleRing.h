@@ -0,0 +1,251 @@
+/*
+  TS_SampleRing.h - Defines struct TS_Sample, a timestamped touchscreen sample,
+  and classes TS_SampleQueue and TS_SampleRing, a fixed-capacity lock-free
+  single-producer/single-consumer ring buffer of those samples.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  The XPT2046_Touchscreen class normally keeps only the most recent touch
+  sample, so samples produced between two calls by the application are lost.
+  When a sample queue is attached to it with attachSampleQueue(), every sample
+  the driver produces (whether from update(), the event-driven sample timer, or
+  asynchronous DMA completion) is also pushed into the queue with a micros()
+  timestamp, and the application drains the queue in batches with
+  readSamples().
+
+  The driver is the single producer and the application is the single
+  consumer. Neither side ever blocks or disables interrupts: the producer only
+  writes the head index and the consumer only writes the tail index. When the
+  queue is full the new sample is dropped and an overflow counter is
+  incremented, so the queue capacity can be sized from the counter.
+
+  To use it, declare a TS_SampleRing with a power-of-two capacity and attach it:
+
+    TS_SampleRing<32> samples;
+    ...
+    ts->attachSampleQueue(&samples);
+    ...
+    TS_Sample buf[8];
+    size_t n = ts->readSamples(buf, 8);
+*/
+/**************************************************************************/
+
+#ifndef TS_SampleRing_h
+#define TS_SampleRing_h
+
+#include <Arduino.h>
+#include <XPT2046_Touchscreen_TT.h>
+
+// Ring index type. It must be read and written atomically by the processor,
+// limiting the capacity to 128 on 8-bit processors.
+#if defined(__AVR__)
+typedef uint8_t TS_RingIndex;
+#define TS_RING_MAX_CAPACITY  128
+#else
+typedef uint16_t TS_RingIndex;
+#define TS_RING_MAX_CAPACITY  32768
+#endif
+
+/**************************************************************************/
+/*!
+  @brief    Struct TS_Sample holds one touchscreen sample, as returned by the
+            touchscreen's getPoint() function, plus the micros() time at which
+            it was read. A sample with p.z == 0 marks the end of a touch (the
+            first sample read after the pressure fell below the threshold).
+*/
+/**************************************************************************/
+struct TS_Sample {
+  TS_Point p;
+  uint32_t us;
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_SampleQueue is a lock-free single-producer/single-consumer
+            queue of TS_Sample objects. It does not own its storage; use class
+            TS_SampleRing to declare a queue with storage of a given size.
+*/
+/**************************************************************************/
+class TS_SampleQueue {
+
+protected:
+
+  // Sample storage, capacity _mask+1 which is a power of two.
+  TS_Sample* _buf;
+  TS_RingIndex _mask;
+
+  // Free-running head (next slot to write, written only by the producer) and
+  // tail (next slot to read, written only by the consumer) indexes.
+  TS_RingIndex _head;
+  TS_RingIndex _tail;
+
+  // Number of samples dropped because the queue was full.
+  volatile uint32_t _overflows;
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  buf       Storage for capacity samples.
+    @param  capacity  Number of samples in buf, a power of two.
+  */
+  /**************************************************************************/
+  TS_SampleQueue(TS_Sample* buf, TS_RingIndex capacity) : _buf(buf),
+      _mask(capacity - 1), _head(0), _tail(0), _overflows(0) {}
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Add a sample to the queue. Called only by the producer.
+    @param  s   The sample to add.
+    @returns  true if the sample was added, false if the queue was full, in
+              which case the overflow counter is incremented.
+  */
+  /**************************************************************************/
+  bool push(const TS_Sample& s) {
+    TS_RingIndex head = _head;
+    TS_RingIndex tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+    if ((TS_RingIndex)(head - tail) > _mask) {
+      _overflows = _overflows + 1;
+      return(false);
+    }
+    _buf[head & _mask] = s;
+    __atomic_store_n(&_head, (TS_RingIndex)(head + 1), __ATOMIC_RELEASE);
+    return(true);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Remove up to max samples from the queue. Called only by the
+            consumer.
+    @param  out   Array to receive the samples, oldest first.
+    @param  max   Maximum number of samples to remove.
+    @returns  Number of samples removed and stored in out.
+  */
+  /**************************************************************************/
+  size_t read(TS_Sample* out, size_t max) {
+    TS_RingIndex tail = _tail;
+    TS_RingIndex head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+    size_t n = (TS_RingIndex)(head - tail);
+    if (n > max)
+      n = max;
+    for (size_t i = 0; i < n; i++)
+      out[i] = _buf[(TS_RingIndex)(tail + i) & _mask];
+    __atomic_store_n(&_tail, (TS_RingIndex)(tail + n), __ATOMIC_RELEASE);
+    return(n);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return number of samples in the queue.
+    @returns  Number of samples that read() would currently return, at most.
+  */
+  /**************************************************************************/
+  size_t available() {
+    return((TS_RingIndex)(__atomic_load_n(&_head, __ATOMIC_ACQUIRE) - _tail));
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the capacity of the queue.
+    @returns  Maximum number of samples the queue can hold.
+  */
+  /**************************************************************************/
+  size_t capacity() { return((size_t)_mask + 1); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return number of samples dropped because the queue was full.
+    @returns  Overflow count since construction or the last resetOverflows().
+  */
+  /**************************************************************************/
+  uint32_t overflows() {
+    #if defined(__AVR__)
+    noInterrupts();
+    uint32_t n = _overflows;
+    interrupts();
+    return(n);
+    #else
+    return(_overflows);
+    #endif
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Reset the overflow counter to 0.
+  */
+  /**************************************************************************/
+  void resetOverflows() {
+    noInterrupts();
+    _overflows = 0;
+    interrupts();
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Discard all samples in the queue. Called only by the consumer.
+  */
+  /**************************************************************************/
+  void clear() {
+    __atomic_store_n(&_tail, __atomic_load_n(&_head, __ATOMIC_ACQUIRE),
+      __ATOMIC_RELEASE);
+  }
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_SampleRing is a TS_SampleQueue with storage for N samples.
+  @param    N   Capacity, a power of two no larger than TS_RING_MAX_CAPACITY.
+*/
+/**************************************************************************/
+template <size_t N>
+class TS_SampleRing : public TS_SampleQueue {
+
+  static_assert(N >= 2 && (N & (N - 1)) == 0,
+    "TS_SampleRing capacity must be a power of two");
+  static_assert(N <= TS_RING_MAX_CAPACITY,
+    "TS_SampleRing capacity is too large for TS_RingIndex");
+
+private:
+
+  TS_Sample _storage[N];
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+  */
+  /**************************************************************************/
+  TS_SampleRing() : TS_SampleQueue(_storage, N) {}
+};
+
+#endif // TS_SampleRing_h
@@ -0,0 +1,225 @@
+/*
+  TS_Stroke.cpp - Simplification and encoding of pen strokes, and decoding of
+  the encoded stream.
+  Released into the public domain.
+
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Arduino.h>
+#include <TS_Stroke.h>
+
+/**************************************************************************/
+// Return whole milliseconds from *base to us, advancing *base by them so that
+// the remainders are not lost.
+static uint32_t elapsedMS(uint32_t* base, uint32_t us) {
+  uint32_t ms = (us - *base) / 1000;
+  *base += ms * 1000;
+  return(ms);
+}
+
+/**************************************************************************/
+TS_StrokeEncoder::TS_StrokeEncoder(uint8_t* buf, TS_RingIndex capacity) :
+    TS_ByteRing(buf, capacity), _tolerance(TS_STROKE_TOLERANCE),
+    _maxMS(TS_STROKE_MAX_MS), _open(false), _written(false), _startX(0),
+    _startY(0), _startUs(0), _anchorX(0), _anchorY(0), _anchorUs(0),
+    _candX(0), _candY(0), _candUs(0), _haveCand(false), _rx(0), _ry(0),
+    _lx(0), _ly(0), _anyDir(true), _maxDist(0), _outX(0), _outY(0),
+    _outUs(0), _haveTime(false), _pointsIn(0), _pointsOut(0) {}
+
+/**************************************************************************/
+void TS_StrokeEncoder::addEvent(const TS_Event& ev) {
+  switch (ev.type) {
+  case TS_TOUCH_EVENT:
+    beginStroke(ev.x, ev.y, ev.us);
+    break;
+  case TS_MOVE_EVENT:
+    addPoint(ev.x, ev.y, ev.us);
+    break;
+  case TS_RELEASE_EVENT:
+    endStroke();
+    break;
+  default:
+    break;
+  }
+}
+
+/**************************************************************************/
+void TS_StrokeEncoder::beginStroke(int16_t x, int16_t y, uint32_t us) {
+  endStroke();
+  _open = true;
+  _written = false;
+  _startX = _candX = x;
+  _startY = _candY = y;
+  _startUs = _candUs = us;
+  if (!_haveTime) {
+    _outUs = us;
+    _haveTime = true;
+  }
+  _pointsIn++;
+  restartSegment();
+}
+
+/**************************************************************************/
+void TS_StrokeEncoder::restartSegment() {
+  _anchorX = _candX;
+  _anchorY = _candY;
+  _anchorUs = _candUs;
+  _haveCand = false;
+  _anyDir = true;
+  _maxDist = 0;
+}
+
+/**************************************************************************/
+void TS_StrokeEncoder::narrow(float dx, float dy, int32_t d2) {
+  // The two tangents from the anchor to the circle of radius tolerance around
+  // the point, scaled by the distance to the point.
+  float e = _tolerance;
+  float w = sqrtf((float) (d2 - (int32_t) _tolerance * _tolerance));
+  float lx = dx*w - dy*e, ly = dy*w + dx*e;
+  float rx = dx*w + dy*e, ry = dy*w - dx*e;
+  if (_anyDir || _rx*ry - _ry*rx > 0) {
+    _rx = rx;
+    _ry = ry;
+  }
+  if (_anyDir || lx*_ly - ly*_lx > 0) {
+    _lx = lx;
+    _ly = ly;
+  }
+  _anyDir = false;
+}
+
+/**************************************************************************/
+void TS_StrokeEncoder::addPoint(int16_t x, int16_t y, uint32_t us) {
+  if (!_open)
+    return;
+  _pointsIn++;
+  int32_t tol2 = (int32_t) _tolerance * _tolerance;
+  int32_t dx = x - _anchorX, dy = y - _anchorY;
+  int32_t d2 = dx*dx + dy*dy;
+  float d = 0;
+
+  // Keep the candidate if the new point is outside the directions within the
+  // tolerance of the points since the anchor, turns back toward the anchor,
+  // or is too long after it.
+  bool keep = _haveCand && _maxMS != 0 &&
+    us - _anchorUs >= (uint32_t) _maxMS * 1000;
+  if (!keep) {
+    d = sqrtf((float) d2);
+    keep = d < _maxDist - _tolerance || (d2 > tol2 && !_anyDir &&
+      (_rx*dy - _ry*dx < 0 || dx*_ly - dy*_lx < 0));
+  }
+  if (keep) {
+    emit(false);
+    restartSegment();
+    dx = x - _anchorX;
+    dy = y - _anchorY;
+    d2 = dx*dx + dy*dy;
+    d = sqrtf((float) d2);
+  }
+
+  if (d2 > tol2) {
+    narrow(dx, dy, d2);
+    if (d > _maxDist)
+      _maxDist = d;
+  }
+  _candX = x;
+  _candY = y;
+  _candUs = us;
+  _haveCand = true;
+}
+
+/**************************************************************************/
+void TS_StrokeEncoder::endStroke() {
+  if (!_open)
+    return;
+  emit(true);
+  _open = false;
+}
+
+/**************************************************************************/
+void TS_StrokeEncoder::emit(bool last) {
+  uint8_t rec[2*TS_STROKE_MAX_RECORD];
+  uint8_t* p = rec;
+  uint32_t outUs = _outUs;
+  int16_t outX = _outX, outY = _outY;
+  if (!_written) {
+    p = TS_putVarint(p, elapsedMS(&outUs, _startUs));
+    p = TS_putZigzag(p, _startX);
+    p = TS_putZigzag(p, _startY);
+    outX = _startX;
+    outY = _startY;
+  }
+  p = TS_putZigzag(p, _candX - outX);
+  p = TS_putZigzag(p, _candY - outY);
+  p = TS_putVarint(p, (elapsedMS(&outUs, _candUs) << 1) | (last ? 1 : 0));
+
+  // Unless this ends the stroke, leave room for the point that will.
+  if (!put(rec, (size_t) (p - rec), last ? 0 : TS_STROKE_MAX_RECORD)) {
+    _overflows = _overflows + 1;
+    return;
+  }
+  _outUs = outUs;
+  _outX = _candX;
+  _outY = _candY;
+  _written = true;
+  _pointsOut++;
+}
+
+/**************************************************************************/
+bool TS_StrokeReader::next(TS_StrokePoint* p) {
+  size_t start = _pos;
+  uint32_t v;
+  int16_t x = _inStroke ? _x : 0;
+  int16_t y = _inStroke ? _y : 0;
+  bool ok = _inStroke ?
+    getDelta(&x) && getDelta(&y) && getVarint(&v) :
+    getVarint(&v) && getDelta(&x) && getDelta(&y);
+  if (!ok) {
+    _pos = start;
+    return(false);
+  }
+  if (_inStroke) {
+    _ms += v >> 1;
+    p->flags = (v & 1) ? TS_STROKE_END : 0;
+    _inStroke = !(v & 1);
+  } else {
+    _ms += v;
+    p->flags = TS_STROKE_START;
+    _inStroke = true;
+  }
+  _x = x;
+  _y = y;
+  p->x = x;
+  p->y = y;
+  p->ms = _ms;
+  return(true);
+}
+
+// -------------------------------------------------------------------------
@@ -0,0 +1,376 @@
+/*
+  TS_Stroke.h - Defines classes TS_StrokeEncoder and TS_StrokeBuffer, which
+  simplify pen strokes as they are drawn and encode them into a compact binary
+  stream, and class TS_StrokeReader, which decodes that stream.
+  Released into the public domain.
+
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  To capture signatures or other pen strokes and send them upstream, feed the
+  touch, move, and release events of TS_Display's event queue to a stroke
+  encoder. Each stroke is simplified as it is drawn: a point is kept only
+  where the stroke turns by more than a tolerance (TS_STROKE_TOLERANCE, 1
+  display pixel, by default) allows, so straight runs of many samples become
+  one segment. Every point dropped lies within the tolerance of the segment
+  that replaces it, and a point is also kept at least every
+  TS_STROKE_MAX_MS milliseconds, so the timing of the pen is preserved. The
+  simplification needs no list of points: the encoder keeps the last point
+  kept, the newest point, and the range of directions still within the
+  tolerance of all points since the last point kept.
+
+  The points kept are appended to a byte ring buffer in a compact binary
+  format, differences from the previous point as varints, about three bytes
+  per point, and the application streams them out in chunks with writeTo()
+  as they are produced, so a long signature never has to fit in RAM. As with
+  XPT2046_TraceRecorder, the buffer is a lock-free single-producer/single-
+  consumer ring, so the encoder can be fed in one task and drained in another.
+  When the buffer is too full for a point, the point is dropped and counted,
+  and the stroke continues from the last point written. Space for the last
+  point of a stroke is always kept, so the stream stays decodable.
+
+  Stream format. Each stroke is a header followed by one or more point
+  records, the last of which ends the stroke:
+
+    Header:
+    varint    Milliseconds from the last point of the previous stroke (0 for
+              the first stroke).
+    zvarint   Display x-coordinate of the first point.
+    zvarint   Display y-coordinate of the first point.
+
+    Point:
+    zvarint   x-coordinate minus that of the previous point.
+    zvarint   y-coordinate minus that of the previous point.
+    varint    Milliseconds from the previous point, times 2, plus 1 if this
+              is the last point of the stroke.
+
+  varint and zvarint are as in the XPT2046_Trace.h format: 7 bits per byte,
+  least significant first, with bit 7 set in all but the last byte, and
+  signed values mapped to 0, -1, 1, -2, ... (zigzag encoding). A stroke that
+  never moved (a dot) has one point record with zero differences.
+
+  Usage:
+
+    TS_StrokeBuffer<256> strokes;
+    ...
+    TS_Event ev;
+    while (ts_display->pollEvent(ev))
+      strokes.addEvent(ev);
+    strokes.writeTo(Serial, Serial.availableForWrite());
+
+  and to decode a stream:
+
+    TS_StrokeReader reader(data, len);
+    TS_StrokePoint p;
+    while (reader.next(&p))
+      ...
+*/
+/**************************************************************************/
+
+#ifndef TS_Stroke_h
+#define TS_Stroke_h
+
+#include <Arduino.h>
+#include <TS_Display.h>
+#include <TS_ByteRing.h>
+
+// Default largest distance in display pixels of a dropped point from the
+// simplified stroke.
+#ifndef TS_STROKE_TOLERANCE
+#define TS_STROKE_TOLERANCE 1
+#endif
+
+// Default longest time in milliseconds between points kept, 0 for no limit.
+#ifndef TS_STROKE_MAX_MS
+#define TS_STROKE_MAX_MS    50
+#endif
+
+// Largest number of bytes in a stroke header or in a point record.
+#define TS_STROKE_MAX_RECORD  (5 + 3 + 3)
+
+// Flags of a decoded point.
+#define TS_STROKE_START   0x01  // First point of a stroke
+#define TS_STROKE_END     0x02  // Last point of a stroke
+
+/**************************************************************************/
+/*!
+  @brief    Struct TS_StrokePoint holds one decoded stroke point: its display
+            coordinates, its time in milliseconds from the start of the
+            stream, and TS_STROKE_START and/or TS_STROKE_END flags.
+*/
+/**************************************************************************/
+struct TS_StrokePoint {
+  int16_t x, y;
+  uint32_t ms;
+  uint8_t flags;
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_StrokeEncoder simplifies strokes and encodes them into a
+            lock-free single-producer/single-consumer ring buffer of bytes,
+            from which the stream is removed with the TS_ByteRing functions.
+            It does not own its storage; use class TS_StrokeBuffer to declare
+            an encoder with storage of a given size.
+*/
+/**************************************************************************/
+class TS_StrokeEncoder : public TS_ByteRing {
+
+protected:
+
+  // Simplification parameters.
+  uint8_t _tolerance;
+  uint16_t _maxMS;
+
+  // true while a stroke is being drawn, and true once its header is written.
+  bool _open;
+  bool _written;
+
+  // First point of the stroke, last point kept (the anchor), and newest point
+  // (the candidate to be kept next).
+  int16_t _startX, _startY;
+  uint32_t _startUs;
+  int16_t _anchorX, _anchorY;
+  uint32_t _anchorUs;
+  int16_t _candX, _candY;
+  uint32_t _candUs;
+  bool _haveCand;
+
+  // Directions from the anchor within the tolerance of all points since it,
+  // counterclockwise from (_rx,_ry) to (_lx,_ly), unless _anyDir is true, and
+  // the greatest distance of those points from the anchor.
+  float _rx, _ry, _lx, _ly;
+  bool _anyDir;
+  float _maxDist;
+
+  // Last point written, and the time from which the next time difference is
+  // measured.
+  int16_t _outX, _outY;
+  uint32_t _outUs;
+  bool _haveTime;
+
+  // Number of points given to the encoder and number kept.
+  uint32_t _pointsIn;
+  uint32_t _pointsOut;
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  buf       Storage for capacity bytes.
+    @param  capacity  Number of bytes in buf, a power of two.
+  */
+  /**************************************************************************/
+  TS_StrokeEncoder(uint8_t* buf, TS_RingIndex capacity);
+
+  // Start a new segment of the simplified stroke at the candidate point.
+  void restartSegment();
+
+  // Narrow the directions within the tolerance to those of point (dx,dy),
+  // d2 = dx*dx+dy*dy, relative to the anchor.
+  void narrow(float dx, float dy, int32_t d2);
+
+  // Append the candidate point to the stream, last if it ends the stroke.
+  void emit(bool last);
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Set the simplification parameters.
+    @param  tolerance   Largest distance in display pixels of a dropped point
+                        from the simplified stroke, 0 to keep every point that
+                        is not on a straight line.
+    @param  maxMS       Longest time in milliseconds between points kept, 0
+                        for no limit.
+  */
+  /**************************************************************************/
+  void setParams(uint8_t tolerance = TS_STROKE_TOLERANCE,
+      uint16_t maxMS = TS_STROKE_MAX_MS) {
+    _tolerance = tolerance;
+    _maxMS = maxMS;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Feed one event from TS_Display::pollEvent() to the encoder. A
+            touch event starts a stroke, move events add points to it, and a
+            release event ends it.
+    @param  ev  The event.
+  */
+  /**************************************************************************/
+  void addEvent(const TS_Event& ev);
+
+  /**************************************************************************/
+  /*!
+    @brief  Start a stroke, ending any stroke being drawn. Called only by the
+            producer.
+    @param  x   Display x-coordinate of the first point.
+    @param  y   Display y-coordinate of the first point.
+    @param  us  micros() time of the first point.
+  */
+  /**************************************************************************/
+  void beginStroke(int16_t x, int16_t y, uint32_t us);
+
+  /**************************************************************************/
+  /*!
+    @brief  Add a point to the stroke being drawn. Called only by the
+            producer. Ignored if no stroke is being drawn.
+    @param  x   Display x-coordinate.
+    @param  y   Display y-coordinate.
+    @param  us  micros() time of the point.
+  */
+  /**************************************************************************/
+  void addPoint(int16_t x, int16_t y, uint32_t us);
+
+  /**************************************************************************/
+  /*!
+    @brief  End the stroke being drawn, writing its last point. Called only by
+            the producer. Ignored if no stroke is being drawn.
+  */
+  /**************************************************************************/
+  void endStroke();
+
+  /**************************************************************************/
+  /*!
+    @brief  Return true if a stroke is being drawn.
+    @returns  true between beginStroke() and endStroke().
+  */
+  /**************************************************************************/
+  bool drawing() { return(_open); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the number of points given to the encoder and the number
+            kept, to measure the simplification.
+    @param  in    Pointer to variable to receive the number of points given.
+    @param  out   Pointer to variable to receive the number of points kept.
+  */
+  /**************************************************************************/
+  void getCounts(uint32_t* in, uint32_t* out) {
+    *in = _pointsIn;
+    *out = _pointsOut;
+  }
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_StrokeBuffer is a TS_StrokeEncoder with storage for N
+            bytes.
+  @param    N   Capacity, a power of two no larger than TS_RING_MAX_CAPACITY
+                and at least 4*TS_STROKE_MAX_RECORD.
+*/
+/**************************************************************************/
+template <size_t N>
+class TS_StrokeBuffer : public TS_StrokeEncoder {
+
+  static_assert((N & (N - 1)) == 0,
+    "TS_StrokeBuffer capacity must be a power of two");
+  static_assert(N >= 4*TS_STROKE_MAX_RECORD,
+    "TS_StrokeBuffer capacity is too small for a stroke");
+  static_assert(N <= TS_RING_MAX_CAPACITY,
+    "TS_StrokeBuffer capacity is too large for TS_RingIndex");
+
+private:
+
+  uint8_t _storage[N];
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+  */
+  /**************************************************************************/
+  TS_StrokeBuffer() : TS_StrokeEncoder(_storage, N) {}
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class TS_StrokeReader decodes a stream made by TS_StrokeEncoder,
+            one point at a time.
+*/
+/**************************************************************************/
+class TS_StrokeReader : public TS_VarintReader {
+
+private:
+
+  // true if the next record is a point record, and the previous point.
+  bool _inStroke;
+  int16_t _x, _y;
+  uint32_t _ms;
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  data  The stream, starting at a stroke header, which must remain
+                  in existence while it is read.
+    @param  len   Number of bytes in data.
+  */
+  /**************************************************************************/
+  TS_StrokeReader(const uint8_t* data, size_t len) :
+      TS_VarintReader(data, len), _inStroke(false), _x(0), _y(0), _ms(0) {}
+
+  /**************************************************************************/
+  /*!
+    @brief  Continue decoding with the next chunk of the stream.
+    @param  data  The chunk, starting with the bytes after position() of the
+                  previous chunk.
+    @param  len   Number of bytes in data.
+  */
+  /**************************************************************************/
+  void setData(const uint8_t* data, size_t len) {
+    _data = data;
+    _len = len;
+    _pos = 0;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the number of bytes of the current data decoded.
+    @returns  Position of the first record not yet decoded; the bytes from
+              there on are the start of an incomplete record.
+  */
+  /**************************************************************************/
+  size_t position() { return(_pos); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Decode the next point.
+    @param  p   Pointer to variable to receive the point.
+    @returns  true if successful, false at the end of the data or if the next
+              record is incomplete.
+  */
+  /**************************************************************************/
+  bool next(TS_StrokePoint* p);
+};
+
+#endif // TS_Stroke_h
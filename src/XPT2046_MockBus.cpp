@@ -0,0 +1,123 @@
+/*
+  XPT2046_MockBus.cpp - Simulated XPT2046 controller replaying raw readings.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Arduino.h>
+#include <XPT2046_MockBus.h>
+
+// Controller command start bit, channel select field, and MODE (8-bit) bit.
+#define CMD_START     0x80
+#define CMD_CHANNEL(c)  (((c) >> 4) & 7)
+#define CMD_MODE_8BIT 0x08
+
+// Channels of the conversions.
+#define CHANNEL_X   1
+#define CHANNEL_Z1  3
+#define CHANNEL_Z2  4
+#define CHANNEL_Y   5
+
+// Channel of each auxiliary input, in eXPT2046_Aux order.
+static const uint8_t auxChannels[XPT2046_AUX_COUNT] = { 0, 2, 6, 7 };
+
+/**************************************************************************/
+int16_t XPT2046_MockBus::noise(uint16_t a) {
+  // xorshift32
+  _rand ^= _rand << 13;
+  _rand ^= _rand >> 17;
+  _rand ^= _rand << 5;
+  if (a == 0)
+    return(0);
+  return((int16_t) (_rand % (2 * (uint32_t) a + 1)) - (int16_t) a);
+}
+
+/**************************************************************************/
+int16_t XPT2046_MockBus::convert(uint8_t cmd) {
+  static const XPT2046_RawSample untouched = { 0, 4095, 0, 0 };
+  if (CMD_CHANNEL(cmd) == CHANNEL_Z1 && _read && _count != 0)
+    _pos = nextPos();
+  _read = true;
+  const XPT2046_RawSample* s = (_count == 0) ? &untouched : &_trace[_pos];
+  bool touched = s->z1 > 0;
+  int16_t v;
+  switch (CMD_CHANNEL(cmd)) {
+  case CHANNEL_Z1:
+    v = s->z1;
+    if (!touched && _zNoise != 0)
+      v += (noise(_zNoise) + _zNoise) / 2;
+    break;
+  case CHANNEL_Z2:
+    v = s->z2;
+    break;
+  case CHANNEL_X:
+  case CHANNEL_Y:
+    v = (CMD_CHANNEL(cmd) == CHANNEL_X) ? s->x : s->y;
+    if (!touched)
+      break;
+    if (_spikePct != 0 && (uint16_t) (noise(50) + 50) < _spikePct)
+      v += noise(_spike);
+    else
+      v += noise(_noise);
+    break;
+  default:
+    v = 0;
+    for (uint8_t i = 0; i < XPT2046_AUX_COUNT; i++)
+      if (CMD_CHANNEL(cmd) == auxChannels[i])
+        v = _aux[i];
+    break;
+  }
+  v = constrain(v, (int16_t) 0, (int16_t) 4095);
+  if (cmd & CMD_MODE_8BIT)
+    v &= 0xFF0;
+  return(v);
+}
+
+/**************************************************************************/
+uint8_t XPT2046_MockBus::transfer(uint8_t b) {
+  // The result of a command is clocked out in the 16 clocks after it: one
+  // idle bit, 12 data bits, and three zero bits.
+  uint8_t out = _out0;
+  _out0 = _out1;
+  _out1 = 0;
+  if (b & CMD_START) {
+    uint16_t w = (uint16_t) convert(b) << 3;
+    _out0 = (uint8_t) (w >> 8);
+    _out1 = (uint8_t) w;
+  }
+  _bytes++;
+  return(out);
+}
+
+/**************************************************************************/
+void XPT2046_MockBus::endTransaction() {
+  _transactions++;
+}
+
+// -------------------------------------------------------------------------
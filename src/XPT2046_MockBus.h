@@ -0,0 +1,271 @@
+/*
+  XPT2046_MockBus.h - Defines struct XPT2046_RawSample and class
+  XPT2046_MockBus, a simulated XPT2046 controller that replays a trace of raw
+  readings, for running and timing the driver without touchscreen hardware.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  XPT2046_MockBus implements the XPT2046_Bus interface by decoding the command
+  bytes sent to it the way the controller does and returning conversion
+  results taken from an array of XPT2046_RawSample, one per sample. Each
+  sample starts with a Z1 conversion, so the mock moves to the next trace
+  sample at the Z1 conversion following any other, and a sample read in
+  several transactions (as in step mode) sees a single trace sample. Noise and spikes can be added to the X and Y readings, and to the
+  pressure of untouched samples, with a deterministic pseudo-random sequence,
+  so the effect of filters and thresholds can be measured repeatably.
+
+  It uses only the Arduino API of the driver itself, so the driver, a mock bus,
+  and TS_Display can also be compiled and run on a PC given stand-ins for the
+  few Arduino functions used.
+
+  Usage with XPT2046_Touchscreen:
+
+    const XPT2046_RawSample trace[] = { ... };
+    XPT2046_MockBus mock(trace, sizeof(trace)/sizeof(trace[0]));
+    ...
+    ts->begin(mock);
+
+  and with XPT2046_TouchscreenT, through a bus policy:
+
+    XPT2046_TouchscreenT<XPT2046_MockBusT<mock>, 1> tsT(TOUCH_CS_PIN);
+*/
+/**************************************************************************/
+
+#ifndef XPT2046_MockBus_h
+#define XPT2046_MockBus_h
+
+#include <Arduino.h>
+#include <XPT2046_Touchscreen_TT.h>
+
+/**************************************************************************/
+/*!
+  @brief    Struct XPT2046_RawSample holds the readings of one simulated
+            sample: pressure readings z1 and z2, and X and Y in controller
+            coordinates (before rotation). An untouched sample has z1 = 0 and
+            z2 = 4095.
+*/
+/**************************************************************************/
+struct XPT2046_RawSample {
+  int16_t z1, z2;
+  int16_t x, y;
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class XPT2046_MockBus is a simulated XPT2046 controller.
+*/
+/**************************************************************************/
+class XPT2046_MockBus : public XPT2046_Bus {
+
+private:
+
+  // Trace being replayed, its length, the index of the current sample,
+  // whether to restart it at the end (else the last sample repeats), and
+  // whether the current sample has been read from.
+  const XPT2046_RawSample* _trace;
+  size_t _count;
+  size_t _pos;
+  bool _loop;
+  bool _read;
+
+  // Amplitude of uniform noise on X/Y readings, percent of X/Y readings that
+  // are spikes, amplitude of spikes, amplitude of noise on untouched
+  // pressure, and pseudo-random generator state.
+  uint16_t _noise;
+  uint8_t _spikePct;
+  uint16_t _spike;
+  uint16_t _zNoise;
+  uint32_t _rand;
+
+  // Readings of the auxiliary inputs.
+  int16_t _aux[XPT2046_AUX_COUNT];
+
+  // Result bytes to be clocked out with the next two bytes.
+  uint8_t _out0, _out1;
+
+  // Number of transactions and bytes transferred.
+  uint32_t _transactions;
+  uint32_t _bytes;
+
+  // Return a pseudo-random number from -a to a.
+  int16_t noise(uint16_t a);
+
+  // Return the result of a conversion command.
+  int16_t convert(uint8_t cmd);
+
+  // Return the index of the trace sample after the current one.
+  size_t nextPos() {
+    return((_pos + 1 < _count) ? _pos + 1 : (_loop ? 0 : _count - 1));
+  }
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  trace   Array of count samples to replay, which must remain in
+                    existence, or nullptr for none (always untouched).
+    @param  count   Number of samples.
+    @param  loop    true to restart the trace after its last sample, false to
+                    repeat the last sample.
+  */
+  /**************************************************************************/
+  XPT2046_MockBus(const XPT2046_RawSample* trace = nullptr, size_t count = 0,
+      bool loop = true) : _trace(trace), _count(count), _pos(0), _loop(loop),
+      _read(false),
+      _noise(0), _spikePct(0), _spike(0), _zNoise(0), _rand(1), _aux(),
+      _out0(0), _out1(0), _transactions(0), _bytes(0) {}
+
+  /**************************************************************************/
+  /*!
+    @brief  Replace the trace, and restart it.
+    @param  trace   Array of count samples to replay.
+    @param  count   Number of samples.
+  */
+  /**************************************************************************/
+  void setTrace(const XPT2046_RawSample* trace, size_t count) {
+    _trace = trace;
+    _count = count;
+    _pos = 0;
+    _read = false;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Set the noise added to the readings.
+    @param  noise     Each X/Y reading is changed by a random amount from
+                      -noise to noise.
+    @param  spikePct  Percent of X/Y readings that are changed by a random
+                      amount from -spike to spike instead.
+    @param  spike     Spike amplitude.
+    @param  zNoise    The pressure of an untouched sample is a random amount
+                      from 0 to zNoise, so that z-threshold tests see noise.
+    @param  seed      Seed of the pseudo-random sequence, not 0.
+  */
+  /**************************************************************************/
+  void setNoise(uint16_t noise, uint8_t spikePct = 0, uint16_t spike = 0,
+      uint16_t zNoise = 0, uint32_t seed = 1) {
+    _noise = noise;
+    _spikePct = spikePct;
+    _spike = spike;
+    _zNoise = zNoise;
+    _rand = (seed == 0) ? 1 : seed;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Set the reading of an auxiliary input.
+    @param  aux   The input.
+    @param  raw   Its reading, 0-4095.
+  */
+  /**************************************************************************/
+  void setAux(eXPT2046_Aux aux, int16_t raw) {
+    if (aux < XPT2046_AUX_COUNT)
+      _aux[aux] = raw;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the sample the next sample read will read.
+    @returns  Pointer to that trace sample, nullptr if there is no trace.
+  */
+  /**************************************************************************/
+  const XPT2046_RawSample* current() {
+    if (_count == 0)
+      return(nullptr);
+    return(&_trace[_read ? nextPos() : _pos]);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return number of transactions so far, one per sample read except
+            in step mode, where each conversion is a transaction.
+    @returns  Number of transactions.
+  */
+  /**************************************************************************/
+  uint32_t transactions() { return(_transactions); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Return number of bytes transferred so far.
+    @returns  Number of bytes.
+  */
+  /**************************************************************************/
+  uint32_t bytes() { return(_bytes); }
+
+  /**************************************************************************/
+  /*!
+    @brief  Transfer one byte, the way SPI.transfer(b) would with a real
+            controller.
+    @param  b   Byte sent.
+    @returns  Byte received.
+  */
+  /**************************************************************************/
+  uint8_t transfer(uint8_t b);
+
+  /**************************************************************************/
+  /*!
+    @brief  Transfer two bytes, most significant first.
+    @param  w   Word sent.
+    @returns  Word received.
+  */
+  /**************************************************************************/
+  uint16_t transfer16(uint16_t w) {
+    uint16_t hi = transfer((uint8_t) (w >> 8));
+    return((hi << 8) | transfer((uint8_t) w));
+  }
+
+  // XPT2046_Bus interface.
+  void beginTransaction() { _out0 = _out1 = 0; }
+  void endTransaction();
+  void transfer(uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; i++)
+      buf[i] = transfer(buf[i]);
+  }
+};
+
+/**************************************************************************/
+/*!
+  @brief    Bus policy for a simulated controller, for use as the Bus parameter
+            of XPT2046_TouchscreenT.
+  @param    Mock  The XPT2046_MockBus object.
+*/
+/**************************************************************************/
+template <XPT2046_MockBus& Mock>
+struct XPT2046_MockBusT {
+  static void begin() {}
+  static void beginTransaction() { Mock.beginTransaction(); }
+  static void endTransaction() { Mock.endTransaction(); }
+  static uint8_t transfer(uint8_t b) { return(Mock.transfer(b)); }
+  static uint16_t transfer16(uint16_t w) { return(Mock.transfer16(w)); }
+};
+
+#endif // XPT2046_MockBus_h
@@ -0,0 +1,381 @@
+/*
+  XPT2046_TouchscreenT.h - Defines C++ class template XPT2046_TouchscreenT, a
+  variant of class XPT2046_Touchscreen whose SPI bus, rotation, filter, and
+  number of readings per sample are fixed at compile time.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  Class XPT2046_Touchscreen decides at run time which SPI device to use, which
+  rotation to apply, and which filter to run, so every sample branches on
+  those. On most boards they never change, and class template
+  XPT2046_TouchscreenT takes them as template parameters instead:
+
+    XPT2046_TouchscreenT<XPT2046_SPIBus<SPI>, 1> ts(TOUCH_CS_PIN, TOUCH_IRQ_PIN);
+
+  The bus is reached directly rather than through a pointer, the SPI settings
+  are constants (which the AVR SPI library reduces to two register values at
+  compile time), the rotation remapping is selected at compile time, and the
+  reading loop has a constant trip count, so the sampling path is straight-line
+  code. It has the same functions as XPT2046_Touchscreen for reading touches
+  (begin(), getPoint(), touched(), tirqTouched(), readData(), bufferEmpty(),
+  setThresholds(), Zthreshold(), Zthreshold_Int()), except that setRotation()
+  and setFilter() are replaced by template parameters.
+
+  The more elaborate sampling modes of XPT2046_Touchscreen (asynchronous,
+  event-driven, sample queue) are not provided, and class TS_Display works only
+  with XPT2046_Touchscreen. Up to XPT2046_MAX_INSTANCES XPT2046_TouchscreenT
+  objects may use a T_IRQ pin.
+*/
+/**************************************************************************/
+
+#ifndef XPT2046_TouchscreenT_h
+#define XPT2046_TouchscreenT_h
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <XPT2046_Touchscreen_TT.h>
+#include <TS_Filter.h>
+
+/**************************************************************************/
+/*!
+  @brief    Bus policy for an XPT2046 on an SPIClass port, for use as the Bus
+            parameter of XPT2046_TouchscreenT.
+  @param    Port      The SPIClass object, e.g. SPI or SPI1.
+  @param    ClockHz   SPI clock frequency.
+*/
+/**************************************************************************/
+template <SPIClass& Port, uint32_t ClockHz = XPT2046_SPI_CLOCK>
+struct XPT2046_SPIBus {
+  static void begin() { Port.begin(); }
+  static void beginTransaction() {
+    Port.beginTransaction(SPISettings(ClockHz, MSBFIRST, SPI_MODE0));
+  }
+  static void endTransaction() { Port.endTransaction(); }
+  static uint8_t transfer(uint8_t b) { return(Port.transfer(b)); }
+  static uint16_t transfer16(uint16_t w) { return(Port.transfer16(w)); }
+};
+
+#if defined(_FLEXIO_SPI_H_)
+/**************************************************************************/
+/*!
+  @brief    Bus policy for an XPT2046 on a FlexIOSPI port, for use as the Bus
+            parameter of XPT2046_TouchscreenT.
+  @param    Port      The FlexIOSPI object.
+  @param    ClockHz   SPI clock frequency.
+*/
+/**************************************************************************/
+template <FlexIOSPI& Port, uint32_t ClockHz = XPT2046_SPI_CLOCK>
+struct XPT2046_FlexIOBus {
+  static void begin() { Port.begin(); }
+  static void beginTransaction() {
+    Port.beginTransaction(FlexIOSPISettings(ClockHz, MSBFIRST, SPI_MODE0));
+  }
+  static void endTransaction() { Port.endTransaction(); }
+  static uint8_t transfer(uint8_t b) { return(Port.transfer(b)); }
+  static uint16_t transfer16(uint16_t w) { return(Port.transfer16(w)); }
+};
+#endif
+
+/**************************************************************************/
+/*!
+  @brief    Compile-time touchscreen rotation, mapping controller coordinates
+            (x,y) to touchscreen coordinates (xraw,yraw) the same way as
+            XPT2046_Touchscreen::setRotation().
+  @param    R   Rotation 0-3.
+*/
+/**************************************************************************/
+template <uint8_t R> struct XPT2046_Rotation;
+template <> struct XPT2046_Rotation<0> {
+  static void apply(int16_t x, int16_t y, int16_t& xraw, int16_t& yraw) {
+    xraw = 4095 - y; yraw = x;
+  }
+};
+template <> struct XPT2046_Rotation<1> {
+  static void apply(int16_t x, int16_t y, int16_t& xraw, int16_t& yraw) {
+    xraw = x; yraw = y;
+  }
+};
+template <> struct XPT2046_Rotation<2> {
+  static void apply(int16_t x, int16_t y, int16_t& xraw, int16_t& yraw) {
+    xraw = y; yraw = 4095 - x;
+  }
+};
+template <> struct XPT2046_Rotation<3> {
+  static void apply(int16_t x, int16_t y, int16_t& xraw, int16_t& yraw) {
+    xraw = 4095 - x; yraw = 4095 - y;
+  }
+};
+
+/**************************************************************************/
+/*!
+  @brief    Compile-time filter selection, calling the TS_Filter.h filter
+            directly instead of through TS_filter().
+  @param    F   The filter.
+*/
+/**************************************************************************/
+template <eTS_Filter F> struct XPT2046_FilterT;
+template <> struct XPT2046_FilterT<TS_FILTER_BEST_TWO_AVG> {
+  static bool apply(int16_t* v, uint8_t n, int16_t& r) {
+    r = TS_filterBestTwoAvg(v, n); return(true);
+  }
+};
+template <> struct XPT2046_FilterT<TS_FILTER_MEDIAN> {
+  static bool apply(int16_t* v, uint8_t n, int16_t& r) {
+    r = TS_filterMedian(v, n); return(true);
+  }
+};
+template <> struct XPT2046_FilterT<TS_FILTER_TRIMMED_MEAN> {
+  static bool apply(int16_t* v, uint8_t n, int16_t& r) {
+    r = TS_filterTrimmedMean(v, n); return(true);
+  }
+};
+template <> struct XPT2046_FilterT<TS_FILTER_RANSAC> {
+  static bool apply(int16_t* v, uint8_t n, int16_t& r) {
+    return(TS_filterRansac(v, n, &r));
+  }
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class template XPT2046_TouchscreenT manages a touchscreen controlled
+            by an XPT_2046 controller, like class XPT2046_Touchscreen, with the
+            bus, rotation, and filter fixed at compile time.
+  @param    Bus       Bus policy, XPT2046_SPIBus or XPT2046_FlexIOBus.
+  @param    Rotation  Touchscreen rotation 0-3, meaning same as display
+                      rotation.
+  @param    Filter    Filter reducing the readings of each coordinate.
+  @param    Samples   Number of X/Y readings per sample, 1 or more.
+*/
+/**************************************************************************/
+template <class Bus, uint8_t Rotation = 1,
+  eTS_Filter Filter = TS_FILTER_BEST_TWO_AVG,
+  uint8_t Samples = XPT2046_DEF_SAMPLES>
+class XPT2046_TouchscreenT {
+
+  static_assert(Rotation < 4, "Rotation must be 0-3");
+  static_assert(Samples >= 1, "Samples must be at least 1");
+
+private:
+
+  // Pins interfacing to controller.
+  uint8_t csPin, tirqPin;
+
+  // Touchscreen most recently read coordinates (xraw,yraw) and pressure (zraw).
+  int16_t xraw, yraw, zraw;
+
+  // Touchscreen pressure thresholds for touch and for clearing isrWake flag.
+  int16_t Z_Threshold, Z_Threshold_Int;
+
+  // Microsecond time of last good read.
+  uint32_t usraw;
+
+  // true when touchscreen interrupt occurs, cleared when touch pressure under
+  // Z_Threshold_Int is detected.
+  volatile bool isrWake;
+
+  // Test touch pressure and update xraw/yraw/zraw and usraw.
+  void update() {
+    if (!isrWake) return;
+    uint32_t now = micros();
+    if (now - usraw < XPT2046_SAMPLE_INTERVAL_US) return;
+    int16_t xs[Samples], ys[Samples];
+    Bus::beginTransaction();
+    digitalWrite(csPin, LOW);
+    Bus::transfer(0xB1 /* Z1 */);
+    int z = (Bus::transfer16(0xC1 /* Z2 */) >> 3) + 4095;
+    z -= Bus::transfer16(0x91 /* X */) >> 3;
+    if (z < Z_Threshold) {
+      Bus::transfer16(0xD0 /* Y */);  // power down
+      Bus::transfer16(0);
+      digitalWrite(csPin, HIGH);
+      Bus::endTransaction();
+      zraw = 0;
+      if (z < Z_Threshold_Int && 255 != tirqPin)
+        isrWake = false;
+      return;
+    }
+    Bus::transfer16(0x91 /* X */);  // dummy X measure, 1st is always noisy
+    for (uint8_t i = 0; i < Samples-1; i++) {
+      xs[i] = Bus::transfer16(0xD1 /* Y */) >> 3;
+      ys[i] = Bus::transfer16(0x91 /* X */) >> 3;
+    }
+    xs[Samples-1] = Bus::transfer16(0xD0 /* Y */) >> 3; // Last Y touch power down
+    ys[Samples-1] = Bus::transfer16(0) >> 3;
+    digitalWrite(csPin, HIGH);
+    Bus::endTransaction();
+    int16_t x, y;
+    if (!XPT2046_FilterT<Filter>::apply(xs, Samples, x) ||
+        !XPT2046_FilterT<Filter>::apply(ys, Samples, y))
+      return;
+    zraw = z;
+    usraw = now;
+    XPT2046_Rotation<Rotation>::apply(x, y, xraw, yraw);
+  }
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief    Construct an XPT2046_TouchscreenT object.
+    @param    cspin   Arduino pin number of pin connected to XPT2046 CS pin.
+    @param    tirq    Arduino pin number of pin connected to XPT2046 IRQ pin, or
+                      255 to not use interrupts.
+  */
+  /**************************************************************************/
+  XPT2046_TouchscreenT(uint8_t cspin, uint8_t tirq=255) : csPin(cspin),
+      tirqPin(tirq), xraw(0), yraw(0), zraw(0), Z_Threshold(Z_THRESHOLD),
+      Z_Threshold_Int(Z_THRESHOLD_INT), usraw(0x80000000), isrWake(true) {}
+
+  /**************************************************************************/
+  /*!
+    @brief    Initialize the bus and XPT2046 and optionally establish
+              interrupts.
+    @returns  true if successful, false if failure
+  */
+  /**************************************************************************/
+  bool begin() {
+    Bus::begin();
+    pinMode(csPin, OUTPUT);
+    digitalWrite(csPin, HIGH);
+    if (255 != tirqPin) {
+      pinMode(tirqPin, INPUT);
+      // The interrupt handler is a non-template function in the .cpp file, so
+      // that ISR_PREFIX takes effect.
+      if (!XPT2046_Touchscreen::attachWakeFlag(tirqPin, &isrWake))
+        return(false);
+    }
+    xraw = yraw = zraw = 0;
+    isrWake = true;
+    return(true);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief    Return last touched point, initially (0,0,0).
+    @returns  The last touched point.
+  */
+  /**************************************************************************/
+  TS_Point getPoint() { update(); return(TS_Point(xraw, yraw, zraw)); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Return flag indicating if ISR was called due to a touch action.
+    @returns  true if interrupt occurred due to a touch action, else false.
+  */
+  /**************************************************************************/
+  bool tirqTouched() { return(isrWake); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Return flag indicating if active touch action exceeds threshold.
+    @returns  true if there is an active touch action that exceeds threshold
+              Z_threshold, else false.
+  */
+  /**************************************************************************/
+  bool touched() { update(); return(zraw >= Z_Threshold); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Get current touch coordinates and pressure.
+    @param    x   Pointer to variable to receive touchscreen x-coordinate.
+    @param    y   Pointer to variable to receive touchscreen y-coordinate.
+    @param    z   Pointer to variable to receive touch pressure.
+  */
+  /**************************************************************************/
+  void readData(uint16_t *x, uint16_t *y, uint8_t *z) {
+    update();
+    *x = xraw;
+    *y = yraw;
+    *z = zraw;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief    Return flag indicating if less than XPT2046_SAMPLE_INTERVAL_US us
+              has elapsed since the last time a press exceeding Z_threshold was
+              recognized.
+    @returns  true if less than XPT2046_SAMPLE_INTERVAL_US us has elapsed,
+              else false.
+  */
+  /**************************************************************************/
+  bool bufferEmpty() {
+    return((micros() - usraw) < XPT2046_SAMPLE_INTERVAL_US);
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief    Return number of touches available in touch buffer returned by
+              getPoint().
+    @returns  1. There is no buffer, just one point.
+  */
+  /**************************************************************************/
+  uint8_t bufferSize() { return(1); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Set touch thresholds, as XPT2046_Touchscreen::setThresholds().
+    @param    Z_Threshold_press       z-threshold for recognizing a press.
+    @param    Z_Threshold_interrupt   z-threshold for clearing the flag returned
+                                      by tirqTouched().
+  */
+  /**************************************************************************/
+  void setThresholds(int16_t Z_Threshold_press = Z_THRESHOLD,
+      int16_t Z_Threshold_interrupt = Z_THRESHOLD_INT) {
+    Z_Threshold = Z_Threshold_press;
+    Z_Threshold_Int = Z_Threshold_interrupt;
+  }
+
+  /**************************************************************************/
+  /*!
+    @brief    Get z-threshold for recognizing a press.
+    @returns  Z_Threshold.
+  */
+  /**************************************************************************/
+  int16_t Zthreshold() { return(Z_Threshold); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Get z-threshold for clearing tirqTouched() flag.
+    @returns  Z_Threshold_Int.
+  */
+  /**************************************************************************/
+  int16_t Zthreshold_Int() { return(Z_Threshold_Int); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Get the compile-time rotation.
+    @returns  Rotation template parameter.
+  */
+  /**************************************************************************/
+  static constexpr uint8_t rotation() { return(Rotation); }
+};
+
+#endif // XPT2046_TouchscreenT_h
@@ -27,47 +27,390 @@
 
 #include <Arduino.h>
 #include <XPT2046_Touchscreen_TT.h>
+#include <TS_SampleRing.h>
+#include <XPT2046_Trace.h>
 
-#define MSEC_THRESHOLD  3
-#define SPI_SETTING     SPISettings(2000000, MSBFIRST, SPI_MODE0)
+// Command byte MODE bit, selecting 8-bit rather than 12-bit conversions.
+#define CMD_MODE_8BIT   0x08
 
-#if defined(_FLEXIO_SPI_H_)
-#define FLEXSPI_SETTING     FlexIOSPISettings(2000000, MSBFIRST, SPI_MODE0)
-#endif
+// Masks applied to results shifted down to 12 bits: in 12-bit mode keeping
+// the 12 result bits, and in 8-bit mode keeping them in the 0-4095 range with
+// the low four bits zero.
+#define RESULT_MASK_12BIT 0xFFF
+#define RESULT_MASK_8BIT  0xFF0
+
+// Result mask for command MODE bits 'mode'.
+#define RESULT_MASK(mode) ((mode) ? RESULT_MASK_8BIT : RESULT_MASK_12BIT)
 
-static XPT2046_Touchscreen 	*isrPinptr;
-void isrPin(void);
+// T_IRQ dispatch table, one slot per instance using a T_IRQ pin, and one
+// interrupt handler per slot, so each instance gets its own wake flag without
+// any per-instance allocation.
+static XPT2046_Touchscreen 	*isrTable[XPT2046_MAX_INSTANCES];
+
+static_assert(XPT2046_MAX_INSTANCES >= 1 && XPT2046_MAX_INSTANCES <= 8,
+	"XPT2046_MAX_INSTANCES must be 1-8");
+
+// Slot used by handler I, keeping unused handlers within the table.
+#define SLOT(I) ((I) < XPT2046_MAX_INSTANCES ? (I) : 0)
+
+// The handlers are generated by a macro rather than a function template,
+// because GCC ignores section attributes such as IRAM_ATTR on template
+// instances.
+#define ISR_HANDLER(I) \
+	ISR_PREFIX \
+	static void isrPin##I( void ) { \
+		isrTable[SLOT(I)]->tirqInterrupt(); \
+	}
+
+ISR_HANDLER(0) ISR_HANDLER(1) ISR_HANDLER(2) ISR_HANDLER(3)
+ISR_HANDLER(4) ISR_HANDLER(5) ISR_HANDLER(6) ISR_HANDLER(7)
+
+static void (*const isrHandlers[8])(void) = {
+	isrPin0, isrPin1, isrPin2, isrPin3,
+	isrPin4, isrPin5, isrPin6, isrPin7
+};
+
+// Wake flag table used by attachWakeFlag(), with its own handler per slot.
+static volatile bool	*flagTable[XPT2046_MAX_INSTANCES];
+
+#define FLAG_HANDLER(I) \
+	ISR_PREFIX \
+	static void flagPin##I( void ) { \
+		*flagTable[SLOT(I)] = true; \
+	}
+
+FLAG_HANDLER(0) FLAG_HANDLER(1) FLAG_HANDLER(2) FLAG_HANDLER(3)
+FLAG_HANDLER(4) FLAG_HANDLER(5) FLAG_HANDLER(6) FLAG_HANDLER(7)
+
+static void (*const flagHandlers[8])(void) = {
+	flagPin0, flagPin1, flagPin2, flagPin3,
+	flagPin4, flagPin5, flagPin6, flagPin7
+};
+
+// One complete acquisition, as issued by readController(), is Z1, Z2, a dummy
+// X, then n X/Y pairs with the last Y powering the ADC down. The result of
+// each command is clocked out during the 16 clocks following it, overlapping
+// the next command, which is sent in the second of those two bytes (as
+// transfer16(cmd) does). Sending the commands back-to-back as one buffer
+// therefore yields the result of conversion i in bytes 1+2i and 2+2i of the
+// received frame.
+
+// Frame field index of Z1, Z2, and the first X/Y reading.
+#define FRAME_Z1    0
+#define FRAME_Z2    1
+#define FRAME_DATA  3
+
+// Return the command for conversion i of a frame with n X/Y pairs, without the
+// MODE bit.
+static uint8_t frameCmd(uint8_t i, uint8_t n) {
+	switch (i) {
+	case 0: return 0xB1;	// Z1
+	case 1: return 0xC1;	// Z2
+	case 2:
+	case 3: return 0x91;	// dummy X, then first X
+	}
+	i -= 4;
+	if (i & 1) return 0x91;	// X
+	return (i/2 == n-1) ? 0xD0 : 0xD1;	// Y, last one powering down
+}
+
+// Fill 'buf' with the command stream for a frame with n X/Y pairs, with
+// command MODE bits 'mode'.
+static void buildFrame(uint8_t *buf, uint8_t n, uint8_t mode) {
+	uint8_t conversions = XPT2046_FRAME_CONVERSIONS(n);
+	*buf++ = frameCmd(0, n) | mode;
+	for (uint8_t i = 1; i < conversions; i++) {
+		*buf++ = 0;
+		*buf++ = frameCmd(i, n) | mode;
+	}
+	*buf++ = 0;
+	*buf = 0;
+}
+
+// Extract the 12-bit result of conversion 'i' from a received frame.
+static inline int16_t frameField(const uint8_t *buf, uint8_t i) {
+	return (int16_t)((((uint16_t)buf[1+2*i] << 8) | buf[2+2*i]) >> 3);
+}
+
+// Number of bytes at the start of a frame that return Z1 and Z2 and start the
+// dummy X conversion.
+#define FRAME_Z_BYTES	5
+
+// Command of each auxiliary input: single-ended 12-bit conversion with the ADC
+// (and internal reference) left on, which also disables PENIRQ.
+#define AUX_PD	(XPT2046_AUX_INTERNAL_REF ? 0x03 : 0x01)
+static const uint8_t auxCmds[XPT2046_AUX_COUNT] = {
+	0x84 | AUX_PD,	// TEMP0
+	0xA4 | AUX_PD,	// VBAT
+	0xE4 | AUX_PD,	// AUX
+	0xF4 | AUX_PD	// TEMP1
+};
+
+#if defined(XPT2046_HAS_ASYNC)
+// Instance whose asynchronous frame is in flight, nullptr if none. Only one
+// frame is in flight at a time, since the transfer may share a bus.
+static XPT2046_Touchscreen *volatile asyncOwner = nullptr;
+
+#if defined(XPT2046_ASYNC_EVENT_RESPONDER)
+static EventResponder asyncEvent;
+
+static void asyncEventHandler(EventResponderRef event) {
+	((XPT2046_Touchscreen *) event.getContext())->asyncComplete();
+}
+#endif
+#endif
 
 bool XPT2046_Touchscreen::begin(
   #if defined(_FLEXIO_SPI_H_)
-    FlexIOSPI &wflexspi) {
+    FlexIOSPI &wflexspi, uint32_t clockHz) {
 	_pflexspi = &wflexspi;
+	_flexSettings = FlexIOSPISettings(clockHz, MSBFIRST, SPI_MODE0);
 	_pflexspi->begin();
   #else
-    SPIClass &wspi) {
+    SPIClass &wspi, uint32_t clockHz) {
 	_pspi = &wspi;
+	_spiSettings = SPISettings(clockHz, MSBFIRST, SPI_MODE0);
 	_pspi->begin();
   #endif
+	_bus = nullptr;
+	return beginPins();
+}
+
+bool XPT2046_Touchscreen::begin(XPT2046_Bus &bus) {
+  #if defined(_FLEXIO_SPI_H_)
+	_pflexspi = nullptr;
+  #else
+	_pspi = nullptr;
+  #endif
+	_bus = &bus;
+	_bus->begin();
+	return beginPins();
+}
+
+bool XPT2046_Touchscreen::beginPins() {
 	pinMode(csPin, OUTPUT);
 	digitalWrite(csPin, HIGH);
 	if (255 != tirqPin) {
+		// Use this instance's slot if begin() was called before, else a free one.
+		if (_isrSlot == 255) {
+			for (uint8_t i = 0; i < XPT2046_MAX_INSTANCES; i++)
+				if (isrTable[i] == nullptr) {
+					_isrSlot = i;
+					break;
+				}
+			if (_isrSlot == 255) return false;
+			isrTable[_isrSlot] = this;
+		}
 		pinMode(tirqPin, INPUT);
-		attachInterrupt(digitalPinToInterrupt(tirqPin), isrPin, FALLING);
-		isrPinptr = this;
+		attachInterrupt(digitalPinToInterrupt(tirqPin), isrHandlers[_isrSlot], FALLING);
 	}
 	xraw = yraw = zraw = 0;
 	isrWake = true;
 	return true;
 }
 
+XPT2046_Touchscreen *XPT2046_Touchscreen::instance(uint8_t slot) {
+	return (slot < XPT2046_MAX_INSTANCES ? isrTable[slot] : nullptr);
+}
+
+uint8_t XPT2046_Touchscreen::touchedMask() {
+	uint8_t mask = 0;
+	for (uint8_t i = 0; i < XPT2046_MAX_INSTANCES; i++)
+		if (isrTable[i] != nullptr && isrTable[i]->isrWake)
+			mask |= (1 << i);
+	return (mask);
+}
+
+uint8_t XPT2046_Touchscreen::serviceTouched(void (*service)(XPT2046_Touchscreen *ts)) {
+	uint8_t mask = touchedMask();
+	uint8_t count = 0;
+	for (uint8_t i = 0; i < XPT2046_MAX_INSTANCES; i++)
+		if (mask & (1 << i)) {
+			service(isrTable[i]);
+			count++;
+		}
+	return (count);
+}
+
+bool XPT2046_Touchscreen::attachWakeFlag(uint8_t pin, volatile bool *flag) {
+	// Use the flag's slot if it was attached before, else a free one.
+	uint8_t slot = 255;
+	for (uint8_t i = 0; i < XPT2046_MAX_INSTANCES; i++)
+		if (flagTable[i] == flag) {
+			slot = i;
+			break;
+		}
+	if (slot == 255) {
+		for (uint8_t i = 0; i < XPT2046_MAX_INSTANCES; i++)
+			if (flagTable[i] == nullptr) {
+				slot = i;
+				break;
+			}
+		if (slot == 255) return false;
+		flagTable[slot] = flag;
+	}
+	attachInterrupt(digitalPinToInterrupt(pin), flagHandlers[slot], FALLING);
+	return true;
+}
+
 ISR_PREFIX
-void isrPin( void ) {
-	XPT2046_Touchscreen *o = isrPinptr;
-	o->set_isrWake(true);
+void XPT2046_Touchscreen::tirqInterrupt() {
+	// Reading the controller also drives T_IRQ low, so in event-driven mode,
+	// where the driver reads on its own, an edge only means a touch if the pin
+	// is still low.
+	if (_eventDriven && digitalRead(tirqPin) != LOW)
+		return;
+	bool wasIdle = !isrWake;
+	isrWake = true;
+	if (wasIdle && _wakeHandler != nullptr)
+		_wakeHandler(this);
+#if defined(XPT2046_HAS_TASK)
+	// Wake the sampling task, which blocks while the screen is idle.
+	TaskHandle_t task = _task;
+	if (wasIdle && task != nullptr) {
+		BaseType_t woken = pdFALSE;
+		vTaskNotifyGiveFromISR(task, &woken);
+		if (woken) portYIELD_FROM_ISR();
+	}
+#endif
+	if (_eventDriven && !_timerRunning) {
+		_timerRunning = true;
+		_timerStart(_eventIntervalUs);
+	}
+}
+
+bool XPT2046_Touchscreen::idle() {
+	if (255 == tirqPin || isrWake || _timerRunning) return false;
+#if XPT2046_STEP_MODE
+	if (_step != 0) return false;
+#endif
+#if defined(XPT2046_HAS_ASYNC)
+	if (_asyncBusy) return false;
+#endif
+	return true;
+}
+
+bool XPT2046_Touchscreen::sleepUntilTouch(void (*sleep)(void)) {
+	if (255 == tirqPin || _isrSlot == 255) return false;
+	// Let a pending read power the controller down and clear isrWake.
+	update();
+	noInterrupts();
+	while (!isrWake) {
+		sleep();	// returns with interrupts enabled
+		noInterrupts();
+	}
+	interrupts();
+	return true;
+}
+
+#if defined(TEENSYDUINO)
+// Default event-driven sample timers on Teensy, one IntervalTimer per T_IRQ
+// dispatch slot.
+static IntervalTimer sampleTimers[XPT2046_MAX_INSTANCES];
+
+template <uint8_t I>
+static void sampleTimerISR(void) {
+	isrTable[SLOT(I)]->sampleTimerTick();
+}
+
+template <uint8_t I>
+static void sampleTimerStart(uint32_t intervalUs) {
+	sampleTimers[SLOT(I)].begin(sampleTimerISR<I>, intervalUs);
+}
+
+template <uint8_t I>
+static void sampleTimerStop(void) {
+	sampleTimers[SLOT(I)].end();
+}
+
+static void (*const sampleTimerStarts[8])(uint32_t intervalUs) = {
+	sampleTimerStart<0>, sampleTimerStart<1>, sampleTimerStart<2>,
+	sampleTimerStart<3>, sampleTimerStart<4>, sampleTimerStart<5>,
+	sampleTimerStart<6>, sampleTimerStart<7>
+};
+
+static void (*const sampleTimerStops[8])(void) = {
+	sampleTimerStop<0>, sampleTimerStop<1>, sampleTimerStop<2>,
+	sampleTimerStop<3>, sampleTimerStop<4>, sampleTimerStop<5>,
+	sampleTimerStop<6>, sampleTimerStop<7>
+};
+#endif
+
+void XPT2046_Touchscreen::attachSampleTimer(void (*start)(uint32_t intervalUs),
+		void (*stop)(void)) {
+	_timerStart = start;
+	_timerStop = stop;
+}
+
+bool XPT2046_Touchscreen::beginEventDriven(uint32_t intervalUs) {
+	if (255 == tirqPin || _isrSlot == 255 || intervalUs == 0 || _threaded ||
+			_stepMode)
+		return false;
+#if defined(_FLEXIO_SPI_H_)
+	if (!_pflexspi && !_bus) return false;
+#else
+	if (!_pspi && !_bus) return false;
+#endif
+#if defined(TEENSYDUINO)
+	if (_timerStart == nullptr && _isrSlot != 255)
+		attachSampleTimer(sampleTimerStarts[_isrSlot], sampleTimerStops[_isrSlot]);
+#endif
+	if (_timerStart == nullptr || _timerStop == nullptr) return false;
+#if defined(XPT2046_HAS_ASYNC)
+	setAsyncMode(false);
+#endif
+	_eventIntervalUs = intervalUs;
+	_sampleReady = false;
+	_eventDriven = true;
+	// If the screen is already being touched there will be no falling edge, so
+	// check for that now.
+	noInterrupts();
+	tirqInterrupt();
+	interrupts();
+	return true;
+}
+
+void XPT2046_Touchscreen::endEventDriven() {
+	if (!_eventDriven) return;
+	noInterrupts();
+	_eventDriven = false;
+	if (_timerRunning) {
+		_timerStop();
+		_timerRunning = false;
+	}
+	interrupts();
+	isrWake = true;
+}
+
+void XPT2046_Touchscreen::sampleTimerTick() {
+	if (!_timerRunning) return;
+	acquire(micros());
+	if (zraw >= Z_Threshold) _sampleReady = true;
+	// Pressure fell below Z_Threshold_Int and isrWake was cleared: the touch has
+	// ended, so stop the timer and wait for the next T_IRQ falling edge.
+	if (!isrWake) {
+		_timerStop();
+		_timerRunning = false;
+	}
 }
 
 TS_Point XPT2046_Touchscreen::getPoint() {
+#if defined(XPT2046_HAS_THREADS)
+	if (_threaded) {
+		uint32_t seq;
+		TS_Point p = readSnapshot(&seq);
+		_takenSeq = seq;
+		return (p);
+	}
+#endif
 	update();
+	if (_eventDriven || _stepMode) {
+		noInterrupts();
+		TS_Point p(xraw, yraw, zraw);
+		_sampleReady = false;
+		interrupts();
+		return (p);
+	}
 	return TS_Point(xraw, yraw, zraw);
 }
 
@@ -76,134 +419,919 @@ bool XPT2046_Touchscreen::tirqTouched() {
 }
 
 bool XPT2046_Touchscreen::touched() {
+#if defined(XPT2046_HAS_THREADS)
+	if (_threaded) {
+		uint32_t seq;
+		return (readSnapshot(&seq).z >= Z_Threshold);
+	}
+#endif
 	update();
 	return (zraw >= Z_Threshold);
 }
 
 void XPT2046_Touchscreen::readData(uint16_t *x, uint16_t *y, uint8_t *z) {
+	TS_Point p = getPoint();
+	*x = p.x;
+	*y = p.y;
+	*z = p.z;
+}
+
+bool XPT2046_Touchscreen::sampleAvailable() {
+#if defined(XPT2046_HAS_THREADS)
+	if (_threaded)
+		return ((int32_t)(__atomic_load_n(&_readySeq, __ATOMIC_ACQUIRE) - _takenSeq) > 0);
+#endif
+	return (_sampleReady);
+}
+
+void XPT2046_Touchscreen::clearWake() {
+	__atomic_store_n(&isrWake, false, __ATOMIC_SEQ_CST);
+	if (_threaded && digitalRead(tirqPin) == LOW)
+		__atomic_store_n(&isrWake, true, __ATOMIC_SEQ_CST);
+}
+
+#if defined(XPT2046_HAS_THREADS)
+void XPT2046_Touchscreen::publishSample() {
+	// Only this function writes _snapSeq and _snap, so the write needs no lock:
+	// fill the unpublished slot, then publish it by incrementing _snapSeq.
+	uint32_t seq = _snapSeq + 1;
+	TS_Point *p = &_snap[seq & 1];
+	__atomic_store_n(&p->x, xraw, __ATOMIC_RELAXED);
+	__atomic_store_n(&p->y, yraw, __ATOMIC_RELAXED);
+	__atomic_store_n(&p->z, zraw, __ATOMIC_RELAXED);
+	__atomic_store_n(&_snapSeq, seq, __ATOMIC_RELEASE);
+	if (zraw >= Z_Threshold)
+		__atomic_store_n(&_readySeq, seq, __ATOMIC_RELEASE);
+}
+
+TS_Point XPT2046_Touchscreen::readSnapshot(uint32_t *seq) {
+	// The published slot is rewritten only after the other one is published,
+	// so it is intact if _snapSeq is unchanged after reading it.
+	uint32_t s0, s1;
+	TS_Point p;
+	do {
+		s0 = __atomic_load_n(&_snapSeq, __ATOMIC_ACQUIRE);
+		const TS_Point *q = &_snap[s0 & 1];
+		p.x = __atomic_load_n(&q->x, __ATOMIC_RELAXED);
+		p.y = __atomic_load_n(&q->y, __ATOMIC_RELAXED);
+		p.z = __atomic_load_n(&q->z, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		s1 = __atomic_load_n(&_snapSeq, __ATOMIC_RELAXED);
+	} while (s0 != s1);
+	*seq = s0;
+	return (p);
+}
+
+bool XPT2046_Touchscreen::beginThreaded() {
+	if (_eventDriven || _stepMode) return false;
+#if defined(_FLEXIO_SPI_H_)
+	if (!_pflexspi && !_bus) return false;
+#else
+	if (!_pspi && !_bus) return false;
+#endif
+#if defined(XPT2046_HAS_ASYNC)
+	setAsyncMode(false);
+#endif
+	if (!_threaded) {
+		publishSample();
+		_takenSeq = _snapSeq;
+		__atomic_store_n(&_threaded, true, __ATOMIC_RELEASE);
+	}
+	return true;
+}
+
+void XPT2046_Touchscreen::endThreaded() {
+	if (!_threaded) return;
+#if defined(XPT2046_HAS_TASK)
+	TaskHandle_t task = _task;
+	if (task != nullptr) {
+		_taskStop = true;
+		xTaskNotifyGive(task);
+		while (_task != nullptr)
+			vTaskDelay(1);
+		_taskStop = false;
+	}
+#endif
+	__atomic_store_n(&_threaded, false, __ATOMIC_RELEASE);
+	isrWake = true;
+}
+
+void XPT2046_Touchscreen::serviceTask() {
+	if (_threaded && sample())
+		publishSample();
+}
+
+#if defined(XPT2046_HAS_TASK)
+void XPT2046_Touchscreen::taskMain(void *arg) {
+	XPT2046_Touchscreen *ts = (XPT2046_Touchscreen *) arg;
+	while (!ts->_taskStop) {
+		ts->serviceTask();
+		TickType_t ticks;
+		if (ts->idle()) {
+			// Block until tirqInterrupt() or endThreaded() gives a notification,
+			// or an auxiliary input conversion is due.
+			ticks = ts->_auxMask ?
+				pdMS_TO_TICKS(ts->_auxIntervalUs / 1000) + 1 : portMAX_DELAY;
+			ulTaskNotifyTake(pdTRUE, ticks);
+		} else {
+			ticks = pdMS_TO_TICKS(ts->_intervalUs / 1000);
+			vTaskDelay(ticks ? ticks : 1);
+		}
+	}
+	ts->_task = nullptr;
+	vTaskDelete(NULL);
+}
+
+bool XPT2046_Touchscreen::beginTask(int8_t core, uint8_t priority,
+		uint32_t stack) {
+	if (_task != nullptr || !beginThreaded()) return false;
+	TaskHandle_t task;
+	if (xTaskCreatePinnedToCore(taskMain, "XPT2046", stack, this, priority,
+			&task, core < 0 ? tskNO_AFFINITY : core) != pdPASS) {
+		endThreaded();
+		return false;
+	}
+	_task = task;
+	// A touch that began before _task was set gave no notification.
+	xTaskNotifyGive(task);
+	return true;
+}
+#endif
+#endif
+
+void XPT2046_Touchscreen::attachSampleQueue(TS_SampleQueue *queue) {
+	noInterrupts();
+	_queue = queue;
+	_queueTouched = false;
+	interrupts();
+}
+
+size_t XPT2046_Touchscreen::readSamples(TS_Sample *out, size_t max) {
+	if (_queue == nullptr) return 0;
 	update();
-	*x = xraw;
-	*y = yraw;
-	*z = zraw;
+	return (_queue->read(out, max));
+}
+
+uint32_t XPT2046_Touchscreen::sampleOverflows() {
+	return (_queue == nullptr ? 0 : _queue->overflows());
+}
+
+void XPT2046_Touchscreen::set8BitMode(bool enable) {
+#if defined(XPT2046_HAS_ASYNC)
+	bool async = _asyncMode;
+	if (async) setAsyncMode(false);
+#endif
+	_mode = enable ? CMD_MODE_8BIT : 0;
+#if defined(XPT2046_HAS_ASYNC)
+	if (async) setAsyncMode(true);
+#endif
+}
+
+void XPT2046_Touchscreen::setFilter(eTS_Filter filter, uint8_t samples) {
+	if (samples < 1) samples = 1;
+	if (samples > XPT2046_MAX_SAMPLES) samples = XPT2046_MAX_SAMPLES;
+#if defined(XPT2046_HAS_ASYNC)
+	bool async = _asyncMode;
+	if (async) setAsyncMode(false);
+#endif
+	noInterrupts();
+	_filter = filter;
+	_samples = samples;
+	interrupts();
+#if defined(XPT2046_HAS_ASYNC)
+	if (async) setAsyncMode(true);
+#endif
 }
 
 bool XPT2046_Touchscreen::bufferEmpty() {
-	return ((millis() - msraw) < MSEC_THRESHOLD);
+	return ((micros() - usraw) < _intervalUs);
+}
+
+void XPT2046_Touchscreen::setSampleInterval(uint32_t us) {
+	noInterrupts();
+	_adaptive = false;
+	_intervalUs = _minIntervalUs = _maxIntervalUs = us;
+	interrupts();
+}
+
+void XPT2046_Touchscreen::setAdaptiveSampleInterval(uint32_t minUs, uint32_t maxUs) {
+	if (maxUs < minUs) maxUs = minUs;
+	noInterrupts();
+	_minIntervalUs = minUs;
+	_maxIntervalUs = maxUs;
+	_intervalUs = minUs;
+	_adaptive = true;
+	interrupts();
+}
+
+void XPT2046_Touchscreen::adaptInterval(bool active) {
+	if (active) {
+		_intervalUs = _minIntervalUs;
+		return;
+	}
+	uint32_t next = _intervalUs + (_intervalUs >> 2) + 1;
+	_intervalUs = (next > _maxIntervalUs) ? _maxIntervalUs : next;
 }
 
-static int16_t besttwoavg( int16_t x , int16_t y , int16_t z ) {
-  int16_t da, db, dc;
-  int16_t reta = 0;
-  if ( x > y ) da = x - y; else da = y - x;
-  if ( x > z ) db = x - z; else db = z - x;
-  if ( z > y ) dc = z - y; else dc = y - z;
+void XPT2046_Touchscreen::setAdaptiveThresholds(bool enable, int16_t minZ,
+		int16_t maxZ) {
+	_adaptZ = enable;
+	_adaptZMin = minZ;
+	_adaptZMax = maxZ;
+}
 
-  if ( da <= db && da <= dc ) reta = (x + y) >> 1;
-  else if ( db <= da && db <= dc ) reta = (x + z) >> 1;
-  else reta = (y + z) >> 1;   //    else if ( dc <= da && dc <= db ) reta = (x + y) >> 1;
+// Move running quantile estimate q16 (in 1/16 units) toward pressure z: up by
+// 'up' if z is above it, else down by 'down'. It settles where the fraction of
+// pressures above it is down/(up+down).
+static void trackQuantile(int32_t *q16, int z, uint16_t up, uint16_t down) {
+	if (((int32_t) z << 4) > *q16)
+		*q16 += up;
+	else if (*q16 >= down)
+		*q16 -= down;
+}
 
-  return (reta);
+void XPT2046_Touchscreen::adaptThresholds(int z) {
+	// Pressures nearer the touch estimate than the noise estimate are touches,
+	// even if below Z_Threshold, so that a threshold that is too high can be
+	// lowered.
+	if (((int32_t) z << 5) < _noiseZ16 + _touchZ16)
+		trackQuantile(&_noiseZ16, z, 19*XPT2046_ADAPT_Z_RATE, XPT2046_ADAPT_Z_RATE);
+	else {
+		trackQuantile(&_touchZ16, z, 2*XPT2046_ADAPT_Z_RATE, 18*XPT2046_ADAPT_Z_RATE);
+		if (_touchZCount < XPT2046_ADAPT_Z_TOUCHES) _touchZCount++;
+	}
+	if (!_adaptZ) return;
+
+	int32_t noise = _noiseZ16 >> 4;
+	int32_t zt = Z_Threshold;
+	if (_touchZCount >= XPT2046_ADAPT_Z_TOUCHES)
+		zt = noise + ((_touchZ16 >> 4) - noise) / 3;
+	if (zt < noise + XPT2046_ADAPT_Z_MARGIN)
+		zt = noise + XPT2046_ADAPT_Z_MARGIN;
+	zt = constrain(zt, (int32_t) _adaptZMin, (int32_t) _adaptZMax);
+	int32_t zi = noise + (zt - noise) / 4;
+	if (zi >= zt) zi = zt - 1;
+	Z_Threshold = (int16_t) zt;
+	Z_Threshold_Int = (int16_t) zi;
 }
 
-// TODO: perhaps a future version should offer an option for more oversampling,
-//       with the RANSAC algorithm https://en.wikipedia.org/wiki/RANSAC
+void XPT2046_Touchscreen::setAuxChannels(uint8_t channels, uint32_t intervalUs) {
+	_auxMask = channels & (XPT2046_AUX_BIT(XPT2046_AUX_COUNT) - 1);
+	_auxIntervalUs = intervalUs;
+	_auxUs = micros() - intervalUs;	// first conversion is due now
+}
+
+uint8_t XPT2046_Touchscreen::auxDue(uint32_t now) {
+	if (_auxMask == 0 || now - _auxUs < _auxIntervalUs) return XPT2046_AUX_COUNT;
+	uint8_t aux = _auxNext;
+	while (!(_auxMask & XPT2046_AUX_BIT(aux)))
+		aux = (aux + 1) % XPT2046_AUX_COUNT;
+	return aux;
+}
+
+bool XPT2046_Touchscreen::getAux(eXPT2046_Aux aux, int16_t *raw) {
+	if (aux >= XPT2046_AUX_COUNT || !(_auxValid & XPT2046_AUX_BIT(aux))) return false;
+	*raw = _auxRaw[aux];
+	return true;
+}
+
+bool XPT2046_Touchscreen::getBatteryMillivolts(uint16_t *mv) {
+	int16_t raw;
+	if (!getAux(XPT2046_AUX_VBAT, &raw)) return false;
+	*mv = (uint16_t) ((uint32_t) raw * XPT2046_VREF_MV * 4 / 4096);
+	return true;
+}
+
+bool XPT2046_Touchscreen::getAuxMillivolts(uint16_t *mv) {
+	int16_t raw;
+	if (!getAux(XPT2046_AUX_IN, &raw)) return false;
+	*mv = (uint16_t) ((uint32_t) raw * XPT2046_VREF_MV / 4096);
+	return true;
+}
+
+bool XPT2046_Touchscreen::getTemperature(int16_t *tenthsC) {
+	int16_t t0, t1;
+	if (!getAux(XPT2046_AUX_TEMP0, &t0) || !getAux(XPT2046_AUX_TEMP1, &t1))
+		return false;
+	// T = 2.573 K/mV * (V(TEMP1) - V(TEMP0)) - 273.
+	int32_t dv = (int32_t) (t1 - t0) * XPT2046_VREF_MV;	// mV * 4096
+	*tenthsC = (int16_t) (dv * 2573 / (4096L * 100) - 2730);
+	return true;
+}
+
+#if XPT2046_STATS
+void XPT2046_Touchscreen::getStats(XPT2046_Stats *stats) {
+	noInterrupts();
+	*stats = _stats;
+	interrupts();
+}
+
+void XPT2046_Touchscreen::resetStats() {
+	noInterrupts();
+	memset(&_stats, 0, sizeof(_stats));
+	_stats.csMinUs = 0xFFFFFFFF;
+	interrupts();
+}
+
+void XPT2046_Touchscreen::statsTransaction(uint32_t t0) {
+	uint32_t us = micros() - t0;
+	_stats.transactions++;
+	_stats.csTotalUs += us;
+	if (us < _stats.csMinUs) _stats.csMinUs = us;
+	if (us > _stats.csMaxUs) _stats.csMaxUs = us;
+}
+
+// Return largest minus smallest of n readings.
+static uint16_t readingSpread(const int16_t *v, uint8_t n) {
+	int16_t lo = v[0], hi = v[0];
+	for (uint8_t i = 1; i < n; i++) {
+		if (v[i] < lo) lo = v[i];
+		if (v[i] > hi) hi = v[i];
+	}
+	return (hi - lo);
+}
+#endif
 
 void XPT2046_Touchscreen::update() {
-	int16_t data[6];
-	int z;
-	if (!isrWake) return;
-	uint32_t now = millis();
-	if (now - msraw < MSEC_THRESHOLD) return;
-#if defined(_FLEXIO_SPI_H_)
-	if (_pflexspi) {
-		_pflexspi->beginTransaction(FLEXSPI_SETTING);
-		digitalWrite(csPin, LOW);
-		_pflexspi->transfer(0xB1 /* Z1 */);
-		int16_t z1 = _pflexspi->transfer16(0xC1 /* Z2 */) >> 3;
-		z = z1 + 4095;
-		int16_t z2 = _pflexspi->transfer16(0x91 /* X */) >> 3;
-		z -= z2;
-		if (z >= Z_Threshold) {
-			_pflexspi->transfer16(0x91 /* X */);  // dummy X measure, 1st is always noisy
-			data[0] = _pflexspi->transfer16(0xD1 /* Y */) >> 3;
-			data[1] = _pflexspi->transfer16(0x91 /* X */) >> 3; // make 3 x-y measurements
-			data[2] = _pflexspi->transfer16(0xD1 /* Y */) >> 3;
-			data[3] = _pflexspi->transfer16(0x91 /* X */) >> 3;
+	// In event-driven mode, sampling is done by sampleTimerTick(), in threaded
+	// mode by serviceTask(), and in step mode by poll().
+	if (_eventDriven || _threaded || _stepMode) return;
+	sample();
+}
+
+bool XPT2046_Touchscreen::sample() {
+#if XPT2046_STATS
+	_stats.updates++;
+#endif
+#if defined(XPT2046_HAS_ASYNC)
+	if (_asyncMode) {
+		updateAsync();
+		return false;
+	}
+#endif
+	uint32_t now = micros();
+	if (!isrWake) {
+		// The controller is idle, so read it only for a due auxiliary input.
+		if (auxDue(now) < XPT2046_AUX_COUNT) {
+			acquire(now);
+			return true;
+		}
+#if XPT2046_STATS
+		_stats.skippedWake++;
+#endif
+		return false;
+	}
+	if (now - usraw < readInterval()) {
+#if XPT2046_STATS
+		_stats.skippedInterval++;
+#endif
+		return false;
+	}
+	acquire(now);
+	return true;
+}
+
+// Read pressure readings z1 and z2 and, if the pressure is at least
+// zThreshold, n X/Y readings from the controller on 'bus'. 'mode' is the
+// command MODE bit, 0 or CMD_MODE_8BIT. If the pressure is below zThreshold
+// and auxCmd is not 0, the auxiliary input conversion auxCmd is done in place
+// of the X/Y readings and its result is stored in *aux.
+template <class Bus, class Settings>
+static void readController(Bus *bus, const Settings &settings, uint8_t csPin,
+		int16_t zThreshold, int16_t *z1, int16_t *z2, int16_t *xs, int16_t *ys,
+		uint8_t n, uint8_t mode, uint8_t auxCmd, int16_t *aux) {
+	uint16_t mask = RESULT_MASK(mode);
+	bus->beginTransaction(settings);
+	digitalWrite(csPin, LOW);
+	bus->transfer(0xB1 /* Z1 */ | mode);
+	*z1 = (bus->transfer16(0xC1 /* Z2 */ | mode) >> 3) & mask;
+	int z = *z1 + 4095;
+	*z2 = (bus->transfer16(0x91 /* X */ | mode) >> 3) & mask;
+	z -= *z2;
+	if (z >= zThreshold) {
+		bus->transfer16(0x91 /* X */ | mode);  // dummy X measure, 1st is always noisy
+		for (uint8_t i = 0; i < n-1; i++) { // make n x-y measurements
+			xs[i] = (bus->transfer16(0xD1 /* Y */ | mode) >> 3) & mask;
+			ys[i] = (bus->transfer16(0x91 /* X */ | mode) >> 3) & mask;
 		}
-		else data[0] = data[1] = data[2] = data[3] = 0;	// Compiler warns these values may be used unset on early exit.
-		data[4] = _pflexspi->transfer16(0xD0 /* Y */) >> 3;	// Last Y touch power down
-		data[5] = _pflexspi->transfer16(0) >> 3;
+	} else if (auxCmd != 0) {
+		// Convert twice, the first conversion letting the reference settle.
+		bus->transfer16(auxCmd);
+		bus->transfer16(auxCmd);
+		*aux = bus->transfer16(0xD0 /* Y */ | mode) >> 3;	// power down
+		bus->transfer16(0);
 		digitalWrite(csPin, HIGH);
-		_pflexspi->endTransaction();
+		bus->endTransaction();
+		return;
+	}
+	xs[n-1] = (bus->transfer16(0xD0 /* Y */ | mode) >> 3) & mask;	// Last Y touch power down
+	ys[n-1] = (bus->transfer16(0) >> 3) & mask;
+	digitalWrite(csPin, HIGH);
+	bus->endTransaction();
+}
+
+// Same as readController(), but with the commands sent as buffers with
+// bus->transfer(buf, len), avoiding the per-call overhead of transfer() and
+// transfer16(), and without beginning or ending the bus transaction. The Z1/Z2
+// part of the frame is sent first and, if the pressure is below zThreshold,
+// the frame is ended early as readController() does.
+template <class Bus>
+static void readControllerFrame(Bus *bus, uint8_t csPin, int16_t zThreshold,
+		int16_t *z1, int16_t *z2, int16_t *xs, int16_t *ys, uint8_t n,
+		uint8_t mode, uint8_t auxCmd, int16_t *aux) {
+	uint16_t mask = RESULT_MASK(mode);
+	uint8_t buf[XPT2046_FRAME_BYTES(XPT2046_MAX_SAMPLES)];
+	buildFrame(buf, n, mode);
+	digitalWrite(csPin, LOW);
+	bus->transfer(buf, FRAME_Z_BYTES);
+	*z1 = frameField(buf, FRAME_Z1) & mask;
+	*z2 = frameField(buf, FRAME_Z2) & mask;
+	if (*z1 + 4095 - *z2 >= zThreshold) {
+		bus->transfer(buf + FRAME_Z_BYTES, XPT2046_FRAME_BYTES(n) - FRAME_Z_BYTES);
+		for (uint8_t i = 0; i < n; i++) {
+			xs[i] = frameField(buf, FRAME_DATA + 2*i) & mask;
+			ys[i] = frameField(buf, FRAME_DATA + 2*i + 1) & mask;
+		}
+	} else if (auxCmd != 0) {
+		// Convert the auxiliary input twice, the first conversion letting the
+		// reference settle, then end as below.
+		uint8_t tail[8] = { 0, auxCmd, 0, auxCmd, 0, (uint8_t)(0xD0 | mode), 0, 0 };
+		bus->transfer(tail, sizeof(tail));
+		*aux = (int16_t)((((uint16_t)tail[4] << 8) | tail[5]) >> 3);
+	} else {
+		// End with a Y command powering the ADC down, and its result.
+		uint8_t tail[4] = { 0, (uint8_t)(0xD0 | mode), 0, 0 };
+		bus->transfer(tail, sizeof(tail));
+	}
+	digitalWrite(csPin, HIGH);
+}
 
+void XPT2046_Touchscreen::acquire(uint32_t now) {
+	int16_t xs[XPT2046_MAX_SAMPLES], ys[XPT2046_MAX_SAMPLES];
+	uint8_t n = _samples;
+	int16_t z1, z2;
+	int16_t zThreshold = xyThreshold();
+	// An auxiliary input conversion, if one is due and the screen isn't touched.
+	uint8_t auxIn = auxDue(now);
+	uint8_t auxCmd = (auxIn < XPT2046_AUX_COUNT) ? auxCmds[auxIn] : 0;
+	int16_t aux = -1;
+#if XPT2046_STATS
+	uint32_t t0 = micros();
+#endif
+	if (_bus) {
+		_bus->beginTransaction();
+		readControllerFrame(_bus, csPin, zThreshold, &z1, &z2, xs, ys, n, _mode,
+			auxCmd, &aux);
+		_bus->endTransaction();
+	}
+#if defined(_FLEXIO_SPI_H_)
+	else if (_pflexspi) {
+		readController(_pflexspi, _flexSettings, csPin, zThreshold, &z1, &z2, xs, ys, n, _mode,
+			auxCmd, &aux);
 	}
 #else
-	if (_pspi) {
-		_pspi->beginTransaction(SPI_SETTING);
-		digitalWrite(csPin, LOW);
-		_pspi->transfer(0xB1 /* Z1 */);
-		int16_t z1 = _pspi->transfer16(0xC1 /* Z2 */) >> 3;
-		z = z1 + 4095;
-		int16_t z2 = _pspi->transfer16(0x91 /* X */) >> 3;
-		z -= z2;
-		if (z >= Z_Threshold) {
-			_pspi->transfer16(0x91 /* X */);  // dummy X measure, 1st is always noisy
-			data[0] = _pspi->transfer16(0xD1 /* Y */) >> 3;
-			data[1] = _pspi->transfer16(0x91 /* X */) >> 3; // make 3 x-y measurements
-			data[2] = _pspi->transfer16(0xD1 /* Y */) >> 3;
-			data[3] = _pspi->transfer16(0x91 /* X */) >> 3;
-		}
-		else data[0] = data[1] = data[2] = data[3] = 0;	// Compiler warns these values may be used unset on early exit.
-		data[4] = _pspi->transfer16(0xD0 /* Y */) >> 3;	// Last Y touch power down
-		data[5] = _pspi->transfer16(0) >> 3;
-		digitalWrite(csPin, HIGH);
+	else if (_pspi) {
+		_pspi->beginTransaction(_spiSettings);
+		readControllerFrame(_pspi, csPin, zThreshold, &z1, &z2, xs, ys, n, _mode,
+			auxCmd, &aux);
 		_pspi->endTransaction();
 	}
 #endif
-	// If we do not have either _pspi or _pflexspi then bail.
+	// If we have no bus then bail.
 	else return;
+#if XPT2046_STATS
+	statsTransaction(t0);
+#endif
+	if (aux >= 0) {
+		_auxRaw[auxIn] = aux;
+		_auxValid |= XPT2046_AUX_BIT(auxIn);
+		_auxNext = (auxIn + 1) % XPT2046_AUX_COUNT;
+		_auxUs = now;
+	}
+
+	processSample(z1, z2, xs, ys, n, now);
+}
+
+// Convert controller coordinates (x,y) to touchscreen coordinates (*rx,*ry) in
+// 'rotation'.
+static inline void rotatePoint(uint8_t rotation, int16_t x, int16_t y,
+		int16_t *rx, int16_t *ry) {
+	switch (rotation) {
+	case 0:
+		*rx = 4095 - y;
+		*ry = x;
+		break;
+	case 1:
+		*rx = x;
+		*ry = y;
+		break;
+	case 2:
+		*rx = y;
+		*ry = 4095 - x;
+		break;
+	default: // 3
+		*rx = 4095 - x;
+		*ry = 4095 - y;
+	}
+}
+
+void XPT2046_Touchscreen::setRejectEdges(int16_t lowX, int16_t lowY,
+		int16_t highX, int16_t highY) {
+	_rejectLowX = lowX;
+	_rejectLowY = lowY;
+	_rejectHighX = highX;
+	_rejectHighY = highY;
+	_masked = _rejectRectCount != 0 || lowX > 0 || lowY > 0 || highX > 0 ||
+		highY > 0;
+}
+
+bool XPT2046_Touchscreen::addRejectRect(int16_t x1, int16_t y1, int16_t x2,
+		int16_t y2) {
+	if (_rejectRectCount >= XPT2046_MAX_REJECT_RECTS) return false;
+	int16_t *r = _rejectRects[_rejectRectCount++];
+	r[0] = min(x1, x2);
+	r[1] = min(y1, y2);
+	r[2] = max(x1, x2);
+	r[3] = max(y1, y2);
+	_masked = true;
+	return true;
+}
+
+void XPT2046_Touchscreen::clearRejectMasks() {
+	_rejectRectCount = 0;
+	setRejectEdges(0, 0, 0, 0);
+}
+
+bool XPT2046_Touchscreen::rejectSample(int16_t z1, int16_t z2, int16_t x,
+		int16_t y) {
+	if (_contactMin != 0) {
+		// Touch resistance R = Rx * (X/4096) * (Z2/Z1 - 1), in units of Rx/4096.
+		uint32_t c = (z1 > 0 && z2 > z1) ? (uint32_t) x * (z2 - z1) / z1 : 0;
+		_contact = (c > 0xFFFF) ? 0xFFFF : (uint16_t) c;
+		if (_contact < _contactMin) return true;
+	}
+	if (!_masked) return false;
+	int16_t rx, ry;
+	rotatePoint(rotation, x, y, &rx, &ry);
+	if (rx < _rejectLowX || ry < _rejectLowY || rx > 4095 - _rejectHighX ||
+			ry > 4095 - _rejectHighY)
+		return true;
+	for (uint8_t i = 0; i < _rejectRectCount; i++) {
+		const int16_t *r = _rejectRects[i];
+		if (rx >= r[0] && ry >= r[1] && rx <= r[2] && ry <= r[3])
+			return true;
+	}
+	return false;
+}
+
+void XPT2046_Touchscreen::queueRelease(uint32_t now) {
+	if (!_queueTouched) return;
+	TS_Sample s = { TS_Point(xraw, yraw, 0), now };
+	if (_queue->push(s))
+		_queueTouched = false;
+}
 
+void XPT2046_Touchscreen::processSample(int16_t z1, int16_t z2, int16_t *xs,
+		int16_t *ys, uint8_t n, uint32_t now) {
+	eTS_Filter filter = _filter;
+	int16_t x, y;
+	bool filtered = false;
+	int z = z1 + 4095 - z2;
+	if (_recorder != nullptr) {
+		// X/Y were read if the pressure reached the threshold used by acquire().
+		bool xy = z >= xyThreshold();
+		_recorder->record(z1, z2, xs, ys, xy ? n : 0, now);
+	}
+	if (_xPlateOhms != 0) {
+		// Touch resistance R = Rx * (X/4096) * (Z2/Z1 - 1), pressure 4095 - R.
+		z = 0;
+		if (z1 > 0 && z2 > z1) {
+			if (!TS_filter(filter, xs, n, &x) || !TS_filter(filter, ys, n, &y))
+				return;
+			filtered = true;
+			uint32_t r = ((uint32_t) _xPlateOhms * x >> 12) * (z2 - z1) / z1;
+			z = (r >= 4095) ? 0 : 4095 - (int) r;
+		}
+	}
 	//Serial.printf("z=%d  ::  z1=%d,  z2=%d  ", z, z1, z2);
 	if (z < 0) z = 0;
+	adaptThresholds(z);
 	if (z < Z_Threshold) { //	if ( !touched ) {
 		// Serial.println();
+#if XPT2046_STATS
+		_stats.zRejected++;
+#endif
 		zraw = 0;
+		_rejecting = false;
+		if (_adaptive) {
+			usraw = now;
+			adaptInterval(false);
+		}
 		if (z < Z_Threshold_Int) { //	if ( !touched ) {
-			if (255 != tirqPin) isrWake = false;
+			if (255 != tirqPin) clearWake();
 		}
+		queueRelease(now);
 		return;
 	}
-	zraw = z;
 
-	// Average pair with least distance between each measured x then y
-	//Serial.printf("    z1=%d,z2=%d  ", z1, z2);
-	//Serial.printf("p=%d,  %d,%d  %d,%d  %d,%d", zraw,
-		//data[0], data[1], data[2], data[3], data[4], data[5]);
-	int16_t x = besttwoavg( data[0], data[2], data[4] );
-	int16_t y = besttwoavg( data[1], data[3], data[5] );
+	// Reduce the n readings of each coordinate to one value. A sample the
+	// filter rejects as noise is discarded, leaving the last sample in place.
+#if XPT2046_STATS
+	if (!filtered) {
+		uint16_t spread = max(readingSpread(xs, n), readingSpread(ys, n));
+		_stats.spreadSamples++;
+		_stats.spreadTotal += spread;
+		if (spread > _stats.spreadMax) _stats.spreadMax = spread;
+	}
+#endif
+	if (!filtered &&
+			(!TS_filter(filter, xs, n, &x) || !TS_filter(filter, ys, n, &y))) {
+#if XPT2046_STATS
+		_stats.filterRejected++;
+#endif
+		return;
+	}
+
+	// A touch in a reject mask, or of too large a contact area, is treated as
+	// untouched, but keeps the wake flag set, and the controller is read again
+	// only after the reject interval. The filtered position is tested, so that
+	// one noisy reading cannot move a touch into or out of a mask.
+	if ((_masked || _contactMin != 0) && rejectSample(z1, z2, x, y)) {
+#if XPT2046_STATS
+		_stats.maskRejected++;
+#endif
+		zraw = 0;
+		usraw = now;
+		_rejecting = true;
+		queueRelease(now);
+		return;
+	}
+	_rejecting = false;
+
+	int16_t lastX = xraw, lastY = yraw, lastZ = zraw;
+	zraw = z;
 
 	//Serial.printf("    %d,%d", x, y);
 	//Serial.println();
 	if (z >= Z_Threshold) {
-		msraw = now;	// good read completed, set wait
-		switch (rotation) {
-		case 0:
-			xraw = 4095 - y;
-			yraw = x;
-			break;
-		case 1:
-			xraw = x;
-			yraw = y;
-			break;
-		case 2:
-			xraw = y;
-			yraw = 4095 - x;
-			break;
-		default: // 3
-			xraw = 4095 - x;
-			yraw = 4095 - y;
+		usraw = now;	// good read completed, set wait
+		if (lastZ == 0) queueRelease(now);
+		rotatePoint(rotation, x, y, &xraw, &yraw);
+		if (_adaptive)
+			adaptInterval(lastZ == 0 ||
+				abs(xraw - lastX) > XPT2046_ADAPT_STILL_XY ||
+				abs(yraw - lastY) > XPT2046_ADAPT_STILL_XY ||
+				abs(zraw - lastZ) > XPT2046_ADAPT_STILL_Z);
+		if (_queue != nullptr) {
+			TS_Sample s = { TS_Point(xraw, yraw, zraw), now };
+			_queue->push(s);
+			_queueTouched = true;
+		}
+	}
+}
+
+void XPT2046_Touchscreen::replaySample(const XPT2046_TraceSample &s) {
+	int16_t xs[XPT2046_MAX_SAMPLES], ys[XPT2046_MAX_SAMPLES];
+	uint8_t n = s.n;
+	if (n == 0) {
+		xs[0] = ys[0] = 0;
+		n = 1;
+	} else {
+		memcpy(xs, s.xs, n * sizeof(xs[0]));
+		memcpy(ys, s.ys, n * sizeof(ys[0]));
+	}
+	processSample(s.z1, s.z2, xs, ys, n, s.us);
+}
+
+#if XPT2046_STEP_MODE
+// A sample in step mode is read with the conversions of a frame, numbered from
+// 1 in _step (frame conversion _step-1), each as a transaction of its own, so
+// each call to poll() does a bounded amount of work. _step is also one of:
+#define STEP_NONE         0     // No sample being read
+#define STEP_POWER_DOWN   0x3F  // Untouched: power the ADC down
+#define STEP_AUX          0x40  // Untouched: two conversions of an auxiliary
+                                // input (STEP_AUX, STEP_AUX+1), then power
+                                // down (STEP_AUX+2)
+#define STEP_PROCESS      0x80  // Filter and store the completed sample
+
+bool XPT2046_Touchscreen::setStepMode(bool enable) {
+	if (!enable) {
+		// Finish the sample being read, leaving the controller powered down.
+		while (_step != STEP_NONE)
+			poll();
+		_stepMode = false;
+		return true;
+	}
+	if (_eventDriven || _threaded) return false;
+#if defined(_FLEXIO_SPI_H_)
+	if (!_pflexspi && !_bus) return false;
+#else
+	if (!_pspi && !_bus) return false;
+#endif
+#if defined(XPT2046_HAS_ASYNC)
+	setAsyncMode(false);
+#endif
+	_sampleReady = false;
+	_stepMode = true;
+	return true;
+}
+
+int16_t XPT2046_Touchscreen::stepConvert(uint8_t cmd) {
+	uint8_t buf[3] = { cmd, 0, 0 };
+#if XPT2046_STATS
+	uint32_t t0 = micros();
+#endif
+	if (_bus) {
+		_bus->beginTransaction();
+		digitalWrite(csPin, LOW);
+		_bus->transfer(buf, sizeof(buf));
+		digitalWrite(csPin, HIGH);
+		_bus->endTransaction();
+	}
+#if defined(_FLEXIO_SPI_H_)
+	else if (_pflexspi) {
+		_pflexspi->beginTransaction(_flexSettings);
+		digitalWrite(csPin, LOW);
+		_pflexspi->transfer(cmd);
+		uint16_t r = _pflexspi->transfer16(0);
+		digitalWrite(csPin, HIGH);
+		_pflexspi->endTransaction();
+		buf[1] = r >> 8;
+		buf[2] = r & 0xFF;
+	}
+#else
+	else if (_pspi) {
+		_pspi->beginTransaction(_spiSettings);
+		digitalWrite(csPin, LOW);
+		_pspi->transfer(buf, sizeof(buf));
+		digitalWrite(csPin, HIGH);
+		_pspi->endTransaction();
+	}
+#endif
+#if XPT2046_STATS
+	statsTransaction(t0);
+#endif
+	return (frameField(buf, 0));
+}
+
+bool XPT2046_Touchscreen::poll() {
+	if (!_stepMode) return false;
+	uint8_t step = _step;
+	if (step == STEP_NONE) {
+		// Start a sample when update() would read one.
+		uint32_t now = micros();
+		if (!isrWake ? auxDue(now) >= XPT2046_AUX_COUNT : now - usraw < readInterval())
+			return false;
+		_stepUs = now;
+		_stepN = _samples;
+		_stepCmdMode = _mode;
+		_stepAux = -1;
+		step = 1;
+	}
+
+	if (step == STEP_PROCESS) {
+		if (_stepAux >= 0) {
+			_auxRaw[_stepAuxIn] = _stepAux;
+			_auxValid |= XPT2046_AUX_BIT(_stepAuxIn);
+			_auxNext = (_stepAuxIn + 1) % XPT2046_AUX_COUNT;
+			_auxUs = _stepUs;
+		}
+		processSample(_stepZ1, _stepZ2, _stepXs, _stepYs, _stepN, _stepUs);
+		_step = STEP_NONE;
+		if (zraw >= Z_Threshold) _sampleReady = true;
+		return true;
+	}
+
+	if (step == STEP_POWER_DOWN) {
+		stepConvert(0xD0 /* Y, power down */ | _stepCmdMode);
+		_step = STEP_PROCESS;
+		return false;
+	}
+
+	if (step >= STEP_AUX) {
+		// Convert twice, the first conversion letting the reference settle.
+		uint8_t k = step - STEP_AUX;
+		int16_t r = stepConvert((k < 2) ? auxCmds[_stepAuxIn] : 0xD0 | _stepCmdMode);
+		if (k == 1) _stepAux = r;
+		_step = (k < 2) ? step + 1 : STEP_PROCESS;
+		return false;
+	}
+
+	uint8_t i = step - 1;
+	uint8_t n = _stepN;
+	uint16_t mask = RESULT_MASK(_stepCmdMode);
+	int16_t r = stepConvert(frameCmd(i, n) | _stepCmdMode) & mask;
+	if (i == FRAME_Z1) {
+		_stepZ1 = r;
+	} else if (i == FRAME_Z2) {
+		_stepZ2 = r;
+		if (_stepZ1 + 4095 - r < xyThreshold()) {
+			// Not touched: read an auxiliary input if one is due, else just power
+			// the ADC down.
+			_stepAuxIn = auxDue(_stepUs);
+			_step = (_stepAuxIn < XPT2046_AUX_COUNT) ? STEP_AUX : STEP_POWER_DOWN;
+			return false;
 		}
+	} else if (i >= FRAME_DATA) {
+		uint8_t j = i - FRAME_DATA;
+		if (j & 1) _stepYs[j/2] = r;
+		else _stepXs[j/2] = r;
+	}
+	_step = (i + 1 < XPT2046_FRAME_CONVERSIONS(n)) ? step + 1 : STEP_PROCESS;
+	return false;
+}
+#endif
+
+#if defined(XPT2046_HAS_ASYNC)
+bool XPT2046_Touchscreen::setAsyncMode(bool enable) {
+	if (enable && (_eventDriven || _threaded || _stepMode)) return false;
+	if (!enable || !_pspi) {
+		// Let any frame in flight finish so CS and the bus are released.
+		asyncDrain();
+		_asyncMode = false;
+		return (!enable);
+	}
+	_frameSamples = _samples;
+	_frameMode = _mode;
+	buildFrame(_frameTx, _frameSamples, _frameMode);
+	_asyncMode = true;
+	return true;
+}
+
+void XPT2046_Touchscreen::asyncDrain() {
+	while (_asyncBusy) {
+	#if defined(XPT2046_ASYNC_SAMD_DMA)
+		// Completion is only detected by polling, see updateAsync().
+		if (!_pspi->isBusy()) asyncComplete();
+	#endif
+	}
+}
+
+void XPT2046_Touchscreen::updateAsync() {
+	if (_asyncBusy) {
+	#if defined(XPT2046_ASYNC_SAMD_DMA)
+		// The SAMD DMA transfer has no completion callback, so completion is
+		// detected here on the next poll.
+		if (_pspi->isBusy()) return;
+		asyncComplete();
+	#else
+		return;
+	#endif
+	}
+	uint32_t now = micros();
+	if (!isrWake) {
+		// Read an auxiliary input that is due with a blocking read, as no frame
+		// is in flight.
+		if (auxDue(now) < XPT2046_AUX_COUNT && asyncOwner == nullptr)
+			acquire(now);
+	#if XPT2046_STATS
+		else
+			_stats.skippedWake++;
+	#endif
+		return;
+	}
+	if (now - usraw < readInterval()) {
+	#if XPT2046_STATS
+		_stats.skippedInterval++;
+	#endif
+		return;
 	}
+	if (asyncOwner != nullptr) return;
+	asyncOwner = this;
+	_asyncBusy = true;
+	#if XPT2046_STATS
+	_statsAsyncUs = micros();
+	#endif
+	_pspi->beginTransaction(_spiSettings);
+	digitalWrite(csPin, LOW);
+	#if defined(XPT2046_ASYNC_EVENT_RESPONDER)
+	asyncEvent.setContext(this);
+	asyncEvent.attachImmediate(&asyncEventHandler);
+	_pspi->transfer(_frameTx, _frameRx, XPT2046_FRAME_BYTES(_frameSamples), asyncEvent);
+	#else
+	_pspi->transfer(_frameTx, _frameRx, XPT2046_FRAME_BYTES(_frameSamples), false);
+	#endif
 }
 
+void XPT2046_Touchscreen::asyncComplete() {
+	int16_t xs[XPT2046_MAX_SAMPLES], ys[XPT2046_MAX_SAMPLES];
+	uint8_t n = _frameSamples;
+	uint16_t mask = RESULT_MASK(_frameMode);
+	digitalWrite(csPin, HIGH);
+	_pspi->endTransaction();
+	#if XPT2046_STATS
+	statsTransaction(_statsAsyncUs);
+	#endif
+	int16_t z1 = frameField(_frameRx, FRAME_Z1) & mask;
+	int16_t z2 = frameField(_frameRx, FRAME_Z2) & mask;
+	for (uint8_t i = 0; i < n; i++) {
+		xs[i] = frameField(_frameRx, FRAME_DATA + 2*i) & mask;
+		ys[i] = frameField(_frameRx, FRAME_DATA + 2*i + 1) & mask;
+	}
+	processSample(z1, z2, xs, ys, n, micros());
+	_asyncBusy = false;
+	asyncOwner = nullptr;
+}
+#endif
+
 // -------------------------------------------------------------------------
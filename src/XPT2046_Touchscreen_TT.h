@@ -77,6 +77,7 @@
 
 #include <Arduino.h>
 #include <SPI.h>
+#include <TS_Filter.h>
 
 #if defined(__IMXRT1062__)
 #if __has_include(<FlexIOSPI.h>)
@@ -84,14 +85,189 @@
 #endif
 #endif
 
+// Asynchronous (DMA) acquisition is supported on Teensy cores whose SPI library
+// provides transfer() with an EventResponder, and on Adafruit SAMD cores whose
+// SPI library provides a non-blocking DMA transfer().
+#if !defined(_FLEXIO_SPI_H_) && defined(SPI_HAS_TRANSFER_ASYNC)
+  #define XPT2046_ASYNC_EVENT_RESPONDER
+  #define XPT2046_HAS_ASYNC
+#elif !defined(_FLEXIO_SPI_H_) && defined(ARDUINO_SAMD_ADAFRUIT)
+  #define XPT2046_ASYNC_SAMD_DMA
+  #define XPT2046_HAS_ASYNC
+#endif
+
 #if ARDUINO < 10600
 #error "Arduino 1.6.0 or later (SPI library) is required"
 #endif
 
+// Default SPI clock frequency.
+#ifndef XPT2046_SPI_CLOCK
+#define XPT2046_SPI_CLOCK 2000000
+#endif
+
+// Default microseconds after a press exceeding Z_Threshold is recognized
+// before the controller is read again, changeable with setSampleInterval(). The
+// former millisecond setting MSEC_THRESHOLD is still honored if defined.
+#ifndef XPT2046_SAMPLE_INTERVAL_US
+#if defined(MSEC_THRESHOLD)
+#define XPT2046_SAMPLE_INTERVAL_US  (MSEC_THRESHOLD * 1000UL)
+#else
+#define XPT2046_SAMPLE_INTERVAL_US  3000
+#endif
+#endif
+
+// Largest change in X or Y, and in pressure Z, between two samples for which
+// the adaptive sample interval treats the touch as stationary and backs off.
+#ifndef XPT2046_ADAPT_STILL_XY
+#define XPT2046_ADAPT_STILL_XY  12
+#endif
+#ifndef XPT2046_ADAPT_STILL_Z
+#define XPT2046_ADAPT_STILL_Z   40
+#endif
+
+// Maximum number of reject rectangles, see addRejectRect().
+#ifndef XPT2046_MAX_REJECT_RECTS
+#define XPT2046_MAX_REJECT_RECTS  4
+#endif
+
+// Default interval between reads while a touch is being rejected by the reject
+// masks or the large-contact detector, microseconds.
+#ifndef XPT2046_REJECT_INTERVAL_US
+#define XPT2046_REJECT_INTERVAL_US  20000
+#endif
+
 // Initial thresholds, for press and for clearing interrupt flag.
 #define Z_THRESHOLD     400
 #define Z_THRESHOLD_INT	75
 
+// Default range of Z_Threshold in adaptive threshold mode, smallest distance
+// kept between Z_Threshold and the idle noise level, and number of touched
+// samples needed before Z_Threshold is set from the touch pressures.
+#ifndef XPT2046_ADAPT_Z_MIN
+#define XPT2046_ADAPT_Z_MIN     100
+#endif
+#ifndef XPT2046_ADAPT_Z_MAX
+#define XPT2046_ADAPT_Z_MAX     800
+#endif
+#ifndef XPT2046_ADAPT_Z_MARGIN
+#define XPT2046_ADAPT_Z_MARGIN  40
+#endif
+#ifndef XPT2046_ADAPT_Z_TOUCHES
+#define XPT2046_ADAPT_Z_TOUCHES 16
+#endif
+// Rate of adaptation of the pressure statistics: each sample moves them by up
+// to 19/16 times this.
+#ifndef XPT2046_ADAPT_Z_RATE
+#define XPT2046_ADAPT_Z_RATE    4
+#endif
+
+// Default interval between auxiliary input conversions, microseconds.
+#ifndef XPT2046_AUX_INTERVAL_US
+#define XPT2046_AUX_INTERVAL_US 100000
+#endif
+
+// Define as 0 if auxiliary inputs are to be converted using the voltage on the
+// controller's VREF pin rather than its internal reference, and define
+// XPT2046_VREF_MV as that voltage in millivolts.
+#ifndef XPT2046_AUX_INTERNAL_REF
+#define XPT2046_AUX_INTERNAL_REF  1
+#endif
+#ifndef XPT2046_VREF_MV
+#define XPT2046_VREF_MV 2500
+#endif
+
+// Number of conversions (Z1, Z2, dummy X, n X/Y pairs) in one acquisition
+// frame, and the number of bytes in that frame when it is sent as a single
+// buffer: one command byte, then two bytes per conversion result, the last of
+// which carries the next command.
+#define XPT2046_FRAME_CONVERSIONS(n)  (3 + 2*(n))
+#define XPT2046_FRAME_BYTES(n)        (1 + 2*XPT2046_FRAME_CONVERSIONS(n))
+
+// Maximum number of XPT2046_Touchscreen instances using a T_IRQ pin, at most 8.
+#ifndef XPT2046_MAX_INSTANCES
+#define XPT2046_MAX_INSTANCES 4
+#endif
+
+// Default sample interval in event-driven mode, microseconds.
+#define XPT2046_EVENT_INTERVAL_US 3000
+
+// Threaded mode (beginThreaded()) is available except on 8-bit AVR processors,
+// which have no second core or RTOS and no atomic 32-bit loads and stores.
+#if !defined(__AVR__)
+#define XPT2046_HAS_THREADS
+#endif
+
+// On ESP32, beginTask() runs sampling in a FreeRTOS task, by default pinned to
+// core 0 so the Arduino loop() core is left to the application. These are the
+// default core (-1 for any), priority, and stack size in bytes of that task.
+#if defined(ESP32)
+#define XPT2046_HAS_TASK
+#ifndef XPT2046_TASK_CORE
+#define XPT2046_TASK_CORE     0
+#endif
+#ifndef XPT2046_TASK_PRIORITY
+#define XPT2046_TASK_PRIORITY 2
+#endif
+#ifndef XPT2046_TASK_STACK
+#define XPT2046_TASK_STACK    3072
+#endif
+#endif
+
+// Define as 1 to keep the statistics returned by getStats(). They cost a few
+// counter increments and two micros() calls per sample.
+#ifndef XPT2046_STATS
+#define XPT2046_STATS 0
+#endif
+
+// Define as 0 to leave out step mode (setStepMode() and poll()), saving the
+// RAM that holds the sample being read in that mode, about 40 bytes.
+#ifndef XPT2046_STEP_MODE
+#define XPT2046_STEP_MODE 1
+#endif
+
+#if XPT2046_STATS
+/**************************************************************************/
+/*!
+  @brief    Struct XPT2046_Stats holds driver statistics, returned by
+            XPT2046_Touchscreen::getStats() when XPT2046_STATS is 1.
+*/
+/**************************************************************************/
+struct XPT2046_Stats {
+  uint32_t updates;         // Calls to update() (getPoint(), touched(), ...)
+  uint32_t skippedWake;     // Calls skipped because isrWake was false
+  uint32_t skippedInterval; // Calls skipped because the sample interval
+                            // had not passed
+  uint32_t transactions;    // SPI transactions (samples) issued
+  uint32_t zRejected;       // Samples below Z_Threshold
+  uint32_t filterRejected;  // Touched samples rejected by the filter
+  uint32_t maskRejected;    // Touched samples rejected by the reject masks
+                            // or the large-contact detector
+  uint32_t csMinUs;         // Shortest, longest, and total time per
+  uint32_t csMaxUs;         // transaction with CS asserted, in microseconds
+  uint32_t csTotalUs;       // (average is csTotalUs / transactions)
+  uint32_t spreadSamples;   // Touched samples whose spread was measured
+  uint32_t spreadTotal;     // Sum and largest of the spread (largest minus
+  uint16_t spreadMax;       // smallest) of the X and Y readings of a sample,
+                            // a measure of noise
+};
+#endif
+
+/**************************************************************************/
+/*!
+  @brief    Enum eXPT2046_Aux selects one of the controller's auxiliary inputs.
+*/
+/**************************************************************************/
+typedef enum _eXPT2046_Aux {
+  XPT2046_AUX_TEMP0,  /*! Temperature diode at low current. */
+  XPT2046_AUX_VBAT,   /*! Battery voltage, divided by 4 in the controller. */
+  XPT2046_AUX_IN,     /*! AUX input. */
+  XPT2046_AUX_TEMP1,  /*! Temperature diode at 91 times the TEMP0 current. */
+  XPT2046_AUX_COUNT   /*! Number of auxiliary inputs. */
+} eXPT2046_Aux;
+
+// Bit of auxiliary input 'aux' in the mask given to setAuxChannels().
+#define XPT2046_AUX_BIT(aux)  (1 << (aux))
+
 /**************************************************************************/
 /*!
   @brief    Class TS_Point holds a touchscreen "point" (x, y, z), where (x,y) is
@@ -138,6 +314,57 @@ public:
 	int16_t x, y, z;
 };
 
+// Timestamped sample queue, defined in TS_SampleRing.h.
+struct TS_Sample;
+class TS_SampleQueue;
+
+// Raw sample recorder and recorded sample, defined in XPT2046_Trace.h.
+class XPT2046_TraceRecorder;
+struct XPT2046_TraceSample;
+
+/**************************************************************************/
+/*!
+  @brief    Class XPT2046_Bus is an interface through which the touchscreen can
+            be read instead of an SPI port, for example a simulated controller
+            (see XPT2046_MockBus.h) or an SPI driver other than SPIClass. Each
+            sample is one transaction: beginTransaction(), one or more
+            transfer() calls while CS is low, then endTransaction().
+*/
+/**************************************************************************/
+class XPT2046_Bus {
+public:
+  /**************************************************************************/
+  /*!
+    @brief    Initialize the bus. Called by XPT2046_Touchscreen::begin().
+  */
+  /**************************************************************************/
+  virtual void begin() {}
+
+  /**************************************************************************/
+  /*!
+    @brief    Start a transaction, e.g. take and configure the SPI port.
+  */
+  /**************************************************************************/
+  virtual void beginTransaction() {}
+
+  /**************************************************************************/
+  /*!
+    @brief    End a transaction.
+  */
+  /**************************************************************************/
+  virtual void endTransaction() {}
+
+  /**************************************************************************/
+  /*!
+    @brief    Send len bytes and replace them with the bytes received, as
+              SPI.transfer(buf, len) does.
+    @param    buf   Bytes to send, replaced by the bytes received.
+    @param    len   Number of bytes.
+  */
+  /**************************************************************************/
+  virtual void transfer(uint8_t *buf, size_t len) = 0;
+};
+
 /**************************************************************************/
 /*!
   @brief    Class XPT2046_Touchscreen manages a touchscreen controlled by an
@@ -148,9 +375,115 @@ class XPT2046_Touchscreen {
 
 private:
 
-  // Test touch pressure and update xraw/yraw/zraw and msraw.
+  // Test touch pressure and update xraw/yraw/zraw and usraw, unless sampling
+  // is done by the sample timer or by serviceTask().
 	void update();
 
+  // The body of update(): read the controller if a touch or auxiliary input
+  // sample is due. Returns true if it was read.
+	bool sample();
+
+  // Clear isrWake at the end of a touch. In threaded mode it is set again if
+  // T_IRQ shows a touch that began while the pressure was read, since that
+  // touch's falling edge may be handled on another core before the clear.
+	void clearWake();
+
+  #if defined(XPT2046_HAS_THREADS)
+  // In threaded mode, publish xraw/yraw/zraw as the snapshot returned by
+  // getPoint(), and read that snapshot, returning its sequence number in *seq.
+	void publishSample();
+	TS_Point readSnapshot(uint32_t *seq);
+  #endif
+
+  #if defined(XPT2046_HAS_TASK)
+  // Body of the sampling task started by beginTask(), argument the object.
+	static void taskMain(void *arg);
+  #endif
+
+  // Read pressure and, if touched, coordinates from the controller, then call
+  // processSample(). Unlike update(), no test is made of isrWake or usraw.
+  // 'now' is the micros() time of the read.
+	void acquire(uint32_t now);
+
+  // Apply pressure thresholds, filtering, and rotation to one acquisition of
+  // pressure z and n X and Y readings in xs and ys, updating xraw/yraw/zraw,
+  // usraw, and isrWake. Filtering may reorder xs and ys.
+	void processSample(int16_t z1, int16_t z2, int16_t *xs, int16_t *ys,
+		uint8_t n, uint32_t now);
+
+  // Push a release sample with time 'now' into _queue if _queueTouched is
+  // set, clearing it if the push succeeds.
+	void queueRelease(uint32_t now);
+
+  // Update the pressure statistics with the pressure z of a sample and, in
+  // adaptive threshold mode, Z_Threshold and Z_Threshold_Int.
+	void adaptThresholds(int z);
+
+  // Return the auxiliary input whose conversion is due at time 'now', or
+  // XPT2046_AUX_COUNT if none.
+	uint8_t auxDue(uint32_t now);
+
+  // Return the pressure at or above which X/Y are read: any pressure with
+  // resistance-based pressure, which needs the X reading.
+	int16_t xyThreshold() { return ((_xPlateOhms != 0) ? 1 : Z_Threshold); }
+
+
+  // Adjust the adaptive sample interval after a read, given whether the read
+  // was touched and whether the touch moved or changed pressure.
+	void adaptInterval(bool active);
+
+  #if defined(XPT2046_HAS_ASYNC)
+  // Asynchronous-mode replacement for update(): detect completion of the frame
+  // in flight, and start a new frame if one is due.
+	void updateAsync();
+
+  // Wait for the frame in flight, if any, to finish, without starting another.
+	void asyncDrain();
+
+  // true when getPoint()/touched()/readData() use asynchronous acquisition.
+	bool _asyncMode;
+
+  // true while an asynchronous frame is in flight.
+	volatile bool _asyncBusy;
+
+  // Number of X/Y readings and command MODE bit of the prebuilt frame.
+	uint8_t _frameSamples;
+	uint8_t _frameMode;
+
+  // Prebuilt command frame and receive buffer for asynchronous acquisition.
+	uint8_t _frameTx[XPT2046_FRAME_BYTES(XPT2046_MAX_SAMPLES)];
+	uint8_t _frameRx[XPT2046_FRAME_BYTES(XPT2046_MAX_SAMPLES)];
+  #endif
+
+  #if XPT2046_STEP_MODE
+  // Next step of the sample being read in step mode (frame conversion _step-1,
+  // or one of the STEP_ values in the .cpp file), its micros() start time,
+  // number of X/Y readings and command MODE bit, the auxiliary input being
+  // read, and the readings so far.
+	uint8_t _step;
+	uint32_t _stepUs;
+	uint8_t _stepN;
+	uint8_t _stepCmdMode;
+	uint8_t _stepAuxIn;
+	int16_t _stepZ1, _stepZ2, _stepAux;
+	int16_t _stepXs[XPT2046_MAX_SAMPLES];
+	int16_t _stepYs[XPT2046_MAX_SAMPLES];
+
+  // Do one conversion with command cmd as an SPI transaction of its own, and
+  // return its result.
+	int16_t stepConvert(uint8_t cmd);
+  #endif
+
+  #if XPT2046_STATS
+  // Statistics returned by getStats(), and micros() time the asynchronous
+  // frame in flight was started.
+	XPT2046_Stats _stats;
+	uint32_t _statsAsyncUs;
+
+  // Record the CS time of a transaction started at micros() time t0.
+	void statsTransaction(uint32_t t0);
+  #endif
+
 	// Pins interfacing to controller.
 	uint8_t csPin, tirqPin;
 
@@ -160,28 +493,169 @@ private:
 	// Touchscreen most recently read coordinates (xraw,yraw) and pressure (zraw).
 	int16_t xraw, yraw, zraw;
 
+  // Filter reducing the X and Y readings of a sample to one value, and number
+  // of X/Y readings per sample.
+	eTS_Filter _filter;
+	uint8_t _samples;
+
   // Touchscreen pressure threshold for touch.
 	int16_t Z_Threshold;
 
   // Touchscreen pressure threshold for clearing isrWake flag.
 	int16_t Z_Threshold_Int;
 
-	// Millisecond time used to require a 3ms period of touch before touch is
-	// registered.
-	uint32_t msraw=0x80000000;
+  // true in adaptive threshold mode, range of Z_Threshold in that mode,
+  // running estimates (in 1/16 units) of the 95th percentile of untouched
+  // pressures (the noise level) and the 10th percentile of touched pressures
+  // (those nearer the touch estimate than the noise estimate), and number of
+  // touched samples seen, up to XPT2046_ADAPT_Z_TOUCHES.
+	bool _adaptZ;
+	int16_t _adaptZMin, _adaptZMax;
+	int32_t _noiseZ16, _touchZ16;
+	uint8_t _touchZCount;
+
+  // X-plate resistance in ohms for resistance-based pressure, 0 to use the
+  // z1 + 4095 - z2 pressure.
+	uint16_t _xPlateOhms;
+
+  // Reject masks in touchscreen coordinates: widths of the bands along the
+  // x = 0, y = 0, x = 4095, and y = 4095 edges, and rectangles (x1,y1)-(x2,y2)
+  // inclusive. _masked is true if any band or rectangle is set.
+	int16_t _rejectLowX, _rejectLowY, _rejectHighX, _rejectHighY;
+	int16_t _rejectRects[XPT2046_MAX_REJECT_RECTS][4];
+	uint8_t _rejectRectCount;
+	bool _masked;
+
+  // Smallest contact resistance (see setContactReject()) accepted, 0 for no
+  // large-contact detection, that of the last touched sample, interval
+  // between reads while a touch is rejected, and true while it is.
+	uint16_t _contactMin;
+	uint16_t _contact;
+	uint32_t _rejectIntervalUs;
+	bool _rejecting;
+
+  // Return true if a touched sample with pressure readings z1 and z2 and the
+  // filtered X/Y position x and y is to be rejected by the reject masks or the
+  // large-contact detector.
+	bool rejectSample(int16_t z1, int16_t z2, int16_t x, int16_t y);
+
+  // Return the interval to wait after the last read before reading again.
+	uint32_t readInterval() {
+	  return ((_rejecting && _rejectIntervalUs > _intervalUs) ? _rejectIntervalUs : _intervalUs);
+	  }
+
+  // Auxiliary inputs to convert (XPT2046_AUX_BIT() mask), interval between
+  // conversions, micros() time of the last one, next input to convert, last
+  // raw reading of each input, and mask of inputs that have been read.
+	uint8_t _auxMask;
+	uint8_t _auxNext;
+	uint32_t _auxIntervalUs;
+	uint32_t _auxUs;
+	int16_t _auxRaw[XPT2046_AUX_COUNT];
+	uint8_t _auxValid;
+
+	// Microsecond time of the last good read (of any read in adaptive mode),
+	// used to wait _intervalUs before the controller is read again.
+	uint32_t usraw=0x80000000;
+
+  // Current sample interval in microseconds, and if _adaptive is true, the
+  // range over which it is varied.
+	uint32_t _intervalUs;
+	uint32_t _minIntervalUs, _maxIntervalUs;
+	bool _adaptive;
 
   #if defined(_FLEXIO_SPI_H_)
 	// Pointer to FlexIOSPI SPI device connected to controller, nullptr if none.
 	FlexIOSPI *_pflexspi;
+
+	// SPI settings used for every transaction, computed once by begin().
+	FlexIOSPISettings _flexSettings;
   #else
 	// Pointer to SPIClass SPI device connected to controller, nullptr if none.
 	SPIClass *_pspi;
+
+	// SPI settings used for every transaction, computed once by begin().
+	SPISettings _spiSettings;
   #endif
 
+	// Bus interface connected to controller, used instead of an SPI port if not
+	// nullptr.
+	XPT2046_Bus *_bus;
+
+  // Set up the CS and IRQ pins and interrupt, the common part of begin().
+	bool beginPins();
+
+  // Command MODE bit, nonzero for 8-bit conversions.
+	uint8_t _mode;
+
   // true when touchscreen interrupt occurs, cleared when touch pressure under
   // Z_Threshold_Int is detected.
 	volatile bool isrWake;
 
+  // Index of this instance in the T_IRQ dispatch table, 255 if none.
+	uint8_t _isrSlot;
+
+  // true when sampling is driven by T_IRQ and the sample timer rather than by
+  // calls to update().
+	bool _eventDriven;
+
+  // true while the sample timer is running in event-driven mode.
+	volatile bool _timerRunning;
+
+  // true when event-driven mode has completed a touched sample not yet
+  // returned by getPoint() or readData().
+	volatile bool _sampleReady;
+
+  // true when sampling is done by serviceTask(), possibly in another task or
+  // on another core, and getPoint(), touched(), and readData() read the snapshot.
+	volatile bool _threaded;
+
+  // true when sampling is done one step at a time by poll().
+	bool _stepMode;
+
+  #if defined(XPT2046_HAS_THREADS)
+  // Samples published by publishSample() in threaded mode, written only by the
+  // sampling task. _snapSeq counts the samples published, the latest of which
+  // is in _snap[_snapSeq & 1]. The other slot is written before _snapSeq is
+  // incremented, so a reader is never kept waiting by a preempted writer.
+	TS_Point _snap[2];
+	uint32_t _snapSeq;
+
+  // _snapSeq of the latest touched sample published, and of the snapshot last
+  // returned by getPoint() (written only by the reader).
+	uint32_t _readySeq;
+	uint32_t _takenSeq;
+
+  #if defined(XPT2046_HAS_TASK)
+  // Sampling task started by beginTask(), nullptr if none, and flag asking it
+  // to stop.
+	TaskHandle_t volatile _task;
+	volatile bool _taskStop;
+  #endif
+  #endif
+
+  // Sample timer interval in event-driven mode, microseconds.
+	uint32_t _eventIntervalUs;
+
+  // Functions that start and stop the event-driven sample timer.
+	void (*_timerStart)(uint32_t intervalUs);
+	void (*_timerStop)(void);
+
+  // Queue receiving every sample, nullptr if none.
+	TS_SampleQueue *_queue;
+
+  // true if the last sample pushed into _queue was a touched sample, so a
+  // release sample is pushed when the touch ends. It stays set if the queue
+  // was full, and the release is pushed with the next sample instead.
+	bool _queueTouched;
+
+  // Recorder receiving the raw readings of every sample, nullptr if none.
+	XPT2046_TraceRecorder *_recorder;
+
+  // Function called from the T_IRQ interrupt when a touch ends idle, nullptr
+  // if none.
+	void (*_wakeHandler)(XPT2046_Touchscreen *ts);
+
 public:
 
   /**************************************************************************/
@@ -190,19 +664,55 @@ public:
     @param    cspin   Arduino pin number of pin connected to XPT2046 CS pin.
     @param    tirq    Arduino pin number of pin connected to XPT2046 IRQ pin, or
                       255 to not use interrupts.
-    @note     Only a single instance is supported.
+    @note     Up to XPT2046_MAX_INSTANCES instances may use an IRQ pin, each
+              with its own wake flag. Any number may be used without one.
   */
   /**************************************************************************/
-	constexpr XPT2046_Touchscreen(uint8_t cspin, uint8_t tirq=255)
-		: csPin(cspin), tirqPin(tirq), rotation(1), xraw(0), yraw(0), zraw(0),
+	XPT2046_Touchscreen(uint8_t cspin, uint8_t tirq=255)
+		:
+      #if defined(XPT2046_HAS_ASYNC)
+		  _asyncMode(false), _asyncBusy(false), _frameSamples(0), _frameMode(0),
+		  _frameTx(), _frameRx(),
+      #endif
+      #if XPT2046_STEP_MODE
+		  _step(0), _stepUs(0), _stepN(0), _stepCmdMode(0), _stepAuxIn(0),
+		  _stepZ1(0), _stepZ2(0), _stepAux(-1), _stepXs(), _stepYs(),
+      #endif
+		  csPin(cspin), tirqPin(tirq), rotation(1), xraw(0), yraw(0), zraw(0),
+		  _filter(TS_FILTER_BEST_TWO_AVG), _samples(XPT2046_DEF_SAMPLES),
 		  Z_Threshold(Z_THRESHOLD), Z_Threshold_Int(Z_THRESHOLD_INT),
-		  msraw(0x80000000),
+		  _adaptZ(false), _adaptZMin(XPT2046_ADAPT_Z_MIN),
+		  _adaptZMax(XPT2046_ADAPT_Z_MAX), _noiseZ16(0),
+		  _touchZ16((int32_t) Z_THRESHOLD << 4), _touchZCount(0), _xPlateOhms(0),
+		  _rejectLowX(0), _rejectLowY(0), _rejectHighX(0), _rejectHighY(0),
+		  _rejectRects(), _rejectRectCount(0), _masked(false), _contactMin(0),
+		  _contact(0), _rejectIntervalUs(XPT2046_REJECT_INTERVAL_US),
+		  _rejecting(false),
+		  _auxMask(0), _auxNext(0), _auxIntervalUs(XPT2046_AUX_INTERVAL_US),
+		  _auxUs(0), _auxRaw(), _auxValid(0),
+		  usraw(0x80000000), _intervalUs(XPT2046_SAMPLE_INTERVAL_US),
+		  _minIntervalUs(XPT2046_SAMPLE_INTERVAL_US),
+		  _maxIntervalUs(XPT2046_SAMPLE_INTERVAL_US), _adaptive(false),
       #if defined(_FLEXIO_SPI_H_)
       _pflexspi(nullptr),
       #else
        _pspi(nullptr),
       #endif
-		  isrWake(true) {
+		  _bus(nullptr), _mode(0), isrWake(true), _isrSlot(255), _eventDriven(false), _timerRunning(false),
+		  _sampleReady(false), _threaded(false), _stepMode(false),
+      #if defined(XPT2046_HAS_THREADS)
+		  _snap(), _snapSeq(0), _readySeq(0), _takenSeq(0),
+      #endif
+      #if defined(XPT2046_HAS_TASK)
+		  _task(nullptr), _taskStop(false),
+      #endif
+		  _eventIntervalUs(XPT2046_EVENT_INTERVAL_US),
+		  _timerStart(nullptr), _timerStop(nullptr), _queue(nullptr),
+		  _queueTouched(false), _recorder(nullptr), _wakeHandler(nullptr)
+		  {
+      #if XPT2046_STATS
+	  resetStats();
+      #endif
 	  }
 
   /**************************************************************************/
@@ -214,16 +724,32 @@ public:
     @param    wspi      Reference to the serial peripheral interface device that
                         is connected to the XPT2046. Argument only present if
                         _FLEXIO_SP_H is not defined.
-    @returns  true if successful, false if failure
+    @param    clockHz   SPI clock frequency, default XPT2046_SPI_CLOCK (2 MHz).
+                        The SPI settings are computed once here rather than on
+                        every transaction.
+    @returns  true if successful, false if failure (more than
+              XPT2046_MAX_INSTANCES instances use an IRQ pin).
   */
   /**************************************************************************/
 	bool begin(
     #if defined(_FLEXIO_SPI_H_)
-    FlexIOSPI &wflexspi);
+    FlexIOSPI &wflexspi, uint32_t clockHz = XPT2046_SPI_CLOCK);
     #else
-  	SPIClass &wspi = SPI);
+  	SPIClass &wspi = SPI, uint32_t clockHz = XPT2046_SPI_CLOCK);
     #endif
 
+  /**************************************************************************/
+  /*!
+    @brief    Initialize the XPT2046 on a bus interface instead of an SPI port,
+              and optionally establish interrupts.
+    @param    bus   The bus interface, which must remain in existence.
+    @returns  true if successful, false if failure (more than
+              XPT2046_MAX_INSTANCES instances use an IRQ pin).
+    @note     Asynchronous mode is not available on a bus interface.
+  */
+  /**************************************************************************/
+	bool begin(XPT2046_Bus &bus);
+
   /**************************************************************************/
   /*!
     @brief    Return last touched point, initially (0,0,0).
@@ -264,10 +790,12 @@ public:
 
   /**************************************************************************/
   /*!
-    @brief    Return flag indicating if at least 3 ms has elapsed since the last
-              time a press exceeding Z_threshold was recognized.
-    @returns  true if less than 3 ms has elapsed since the last time a press
-              exceeding Z_threshold was recognized, false if more than 3 ms.
+    @brief    Return flag indicating if less than the sample interval has
+              elapsed since the last time a press exceeding Z_threshold was
+              recognized.
+    @returns  true if less than sampleInterval() microseconds have elapsed
+              since the last time a press exceeding Z_threshold was recognized,
+              else false.
     @note     If true is returned, it can be assumed that a touch just happened
               and may still be in motion and not settled, whereas if false is
               returned, no activity has happened for a while and the last touch
@@ -276,6 +804,56 @@ public:
   /**************************************************************************/
 	bool bufferEmpty();
 
+  /**************************************************************************/
+  /*!
+    @brief    Set a fixed minimum time between reads of the controller while
+              touched, turning off the adaptive sample interval.
+    @param    us    Sample interval in microseconds, default
+                    XPT2046_SAMPLE_INTERVAL_US (3000). 1000-2000 gives the
+                    500-1000 Hz needed for handwriting capture if touched() or
+                    getPoint() is called that often.
+    @note     This does not change the event-driven mode timer interval, which
+              is given to beginEventDriven().
+  */
+  /**************************************************************************/
+	void setSampleInterval(uint32_t us);
+
+  /**************************************************************************/
+  /*!
+    @brief    Turn on the adaptive sample interval, which varies the time
+              between reads between minUs and maxUs.
+    @param    minUs   Interval used while the touch position or pressure is
+                      changing, microseconds.
+    @param    maxUs   Longest interval, reached when the touch is stationary or
+                      the screen is not being touched.
+    @note     Each read that finds the touch moving or newly pressed returns the
+              interval to minUs. Each read that finds it stationary (within
+              XPT2046_ADAPT_STILL_XY and XPT2046_ADAPT_STILL_Z of the previous
+              sample), or untouched, lengthens it by a quarter up to maxUs. In
+              adaptive mode the interval also applies to untouched reads, so
+              without an IRQ pin an idle screen is polled only every maxUs.
+  */
+  /**************************************************************************/
+	void setAdaptiveSampleInterval(uint32_t minUs, uint32_t maxUs);
+
+  /**************************************************************************/
+  /*!
+    @brief    Return the current sample interval.
+    @returns  Current minimum time between reads of the controller,
+              microseconds.
+  */
+  /**************************************************************************/
+	uint32_t sampleInterval() { return(_intervalUs); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Return the time of the last good read.
+    @returns  micros() time at which the sample returned by getPoint() was
+              read, unchanged until a new sample is read.
+  */
+  /**************************************************************************/
+	uint32_t sampleTime() { return(usraw); }
+
   /**************************************************************************/
   /*!
     @brief    Return number of touches available in touch buffer returned by
@@ -311,6 +889,261 @@ public:
 	  Z_Threshold = Z_Threshold_press; Z_Threshold_Int = Z_Threshold_interrupt;
 	  }
 
+  /**************************************************************************/
+  /*!
+    @brief    Enable or disable adaptive touch thresholds.
+    @param    enable  true to adjust Z_Threshold and Z_Threshold_Int
+                      automatically, false to keep the values last set.
+    @param    minZ    Smallest value for Z_Threshold.
+    @param    maxZ    Largest value for Z_Threshold.
+    @note     The driver keeps running estimates, in a few bytes, of the 95th
+              percentile of the pressure of untouched samples (the noise
+              level) and of the 10th percentile of the pressure of touched
+              samples, each sample being counted as touched if its pressure
+              is nearer the touch estimate than the noise estimate, even if
+              below Z_Threshold. Z_Threshold is kept at least XPT2046_ADAPT_Z_MARGIN
+              above the noise level, which stops phantom touches at once.
+              Once XPT2046_ADAPT_Z_TOUCHES touched samples have been seen, it
+              is set a third of the way from the noise level to the light-touch
+              pressure, lowering it for a panel that reads low so that hard
+              presses aren't needed. Z_Threshold_Int is set a quarter of the
+              way from the noise level to Z_Threshold.
+    @note     With an IRQ pin, few untouched samples are read, so the noise
+              level is learned mostly from the samples read as a touch ends.
+  */
+  /**************************************************************************/
+	void setAdaptiveThresholds(bool enable, int16_t minZ = XPT2046_ADAPT_Z_MIN,
+		int16_t maxZ = XPT2046_ADAPT_Z_MAX);
+
+  /**************************************************************************/
+  /*!
+    @brief    Get the pressure statistics used by adaptive thresholds.
+    @param    noise   Pointer to variable to receive the estimated 95th
+                      percentile of untouched pressures.
+    @param    touch   Pointer to variable to receive the estimated 10th
+                      percentile of touched pressures.
+    @note     The statistics are kept whether or not adaptive thresholds are
+              enabled, so they can be used to choose fixed thresholds.
+  */
+  /**************************************************************************/
+	void getPressureStats(int16_t *noise, int16_t *touch) {
+	  *noise = (int16_t) (_noiseZ16 >> 4); *touch = (int16_t) (_touchZ16 >> 4);
+	  }
+
+  /**************************************************************************/
+  /*!
+    @brief    Select resistance-based pressure.
+    @param    xPlateOhms  Resistance of the touchscreen X plate in ohms, found
+                          in the touchscreen's data sheet or measured between
+                          its X+ and X- connections, or 0 for the default
+                          pressure z1 + 4095 - z2.
+    @note     The default pressure depends on the touch position as well as
+              on how hard the screen is pressed. With resistance-based
+              pressure, the touch resistance is computed with the formula of
+              the XPT2046 data sheet, R = Rx * (X/4096) * (Z2/Z1 - 1), which
+              doesn't depend on position, and the pressure is 4095 - R (0 if R
+              is 4095 ohms or more), so it is still larger for harder presses.
+              Thresholds should be set, or adapted, to suit.
+    @note     X/Y readings are then taken on every read, since the pressure
+              needs the X position.
+  */
+  /**************************************************************************/
+	void setPressureResistance(uint16_t xPlateOhms) { _xPlateOhms = xPlateOhms; }
+
+  /**************************************************************************/
+  /*!
+    @brief    Set bands along the edges of the touchscreen in which touches
+              are rejected, e.g. where a bezel presses on the touchscreen.
+    @param    lowX    Width of the band along x = 0, in touchscreen units.
+    @param    lowY    Width of the band along y = 0.
+    @param    highX   Width of the band along x = 4095.
+    @param    highY   Width of the band along y = 4095.
+    @note     The bands, like the rectangles of addRejectRect(), are in the
+              touchscreen coordinates returned by getPoint(), after rotation,
+              and are tested with the filtered X/Y position of a sample, so a
+              single noisy reading does not decide it. A rejected sample is treated as untouched, except
+              that the wake flag stays set; see setRejectInterval().
+  */
+  /**************************************************************************/
+	void setRejectEdges(int16_t lowX, int16_t lowY, int16_t highX, int16_t highY);
+
+  /**************************************************************************/
+  /*!
+    @brief    Add a rectangle in which touches are rejected, e.g. where a hand
+              rests.
+    @param    x1  Touchscreen x-coordinate of one corner.
+    @param    y1  Touchscreen y-coordinate of that corner.
+    @param    x2  Touchscreen x-coordinate of the opposite corner.
+    @param    y2  Touchscreen y-coordinate of that corner.
+    @returns  true if successful, false if XPT2046_MAX_REJECT_RECTS rectangles
+              are already set.
+  */
+  /**************************************************************************/
+	bool addRejectRect(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+
+  /**************************************************************************/
+  /*!
+    @brief    Remove the reject edge bands and all reject rectangles.
+  */
+  /**************************************************************************/
+	void clearRejectMasks();
+
+  /**************************************************************************/
+  /*!
+    @brief    Enable or disable the large-contact detector, which rejects
+              touches of a large area, such as a resting palm, or of several
+              points at once, from their low contact resistance.
+    @param    minContact  Smallest contact resistance accepted, 0 to disable.
+                          The contact resistance is X * (Z2 - Z1) / Z1, the
+                          touch resistance of the data sheet formula in units
+                          of 1/4096 of the X-plate resistance; it does not
+                          depend on the touch position.
+    @note     The contact resistance of each touched sample is returned by
+              contact() while the detector is enabled, so a threshold can be
+              chosen by enabling it with minContact 1 and comparing fingers,
+              styluses, and palms on the actual touchscreen.
+  */
+  /**************************************************************************/
+	void setContactReject(uint16_t minContact) { _contactMin = minContact; }
+
+  /**************************************************************************/
+  /*!
+    @brief    Return the contact resistance of the last touched sample, see
+              setContactReject().
+    @returns  Contact resistance, 0 if the large-contact detector is disabled.
+  */
+  /**************************************************************************/
+	uint16_t contact() { return (_contact); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Set the interval between reads while a touch is being rejected.
+    @param    us  Interval in microseconds, used in place of a shorter sample
+                  interval until a sample is accepted or untouched.
+    @note     A touch that is rejected keeps the controller's pen interrupt
+              asserted, so without a longer interval a resting hand would be
+              read as often as a real touch. Rejected samples never complete
+              a sample for sampleAvailable() or reach getPoint() as touched.
+  */
+  /**************************************************************************/
+	void setRejectInterval(uint32_t us) { _rejectIntervalUs = us; }
+
+  /**************************************************************************/
+  /*!
+    @brief    Select the auxiliary inputs (temperature, battery voltage, AUX)
+              to be converted, and how often.
+    @param    channels    Mask of XPT2046_AUX_BIT(aux) bits of the inputs to
+                          convert, 0 to stop converting them.
+    @param    intervalUs  Minimum time between conversions, microseconds.
+                          Each conversion reads the next selected input in
+                          turn, so each is refreshed every intervalUs times
+                          the number of inputs selected.
+    @note     Conversions never delay a touch sample: one is added to the end
+              of a read that finds the screen untouched, in place of the X/Y
+              readings, or, when an IRQ pin shows the screen untouched and the
+              controller is idle, update() reads the controller just for it.
+              So readings are not refreshed during a touch, nor in
+              event-driven mode.
+  */
+  /**************************************************************************/
+	void setAuxChannels(uint8_t channels,
+		uint32_t intervalUs = XPT2046_AUX_INTERVAL_US);
+
+  /**************************************************************************/
+  /*!
+    @brief    Get the last raw reading of an auxiliary input.
+    @param    aux   The input.
+    @param    raw   Pointer to variable to receive the reading, 0-4095 for 0
+                    to XPT2046_VREF_MV.
+    @returns  true if successful, false if the input has not yet been read.
+  */
+  /**************************************************************************/
+	bool getAux(eXPT2046_Aux aux, int16_t *raw);
+
+  /**************************************************************************/
+  /*!
+    @brief    Get the battery voltage on the VBAT input.
+    @param    mv  Pointer to variable to receive the voltage, millivolts.
+    @returns  true if successful, false if it has not yet been read.
+  */
+  /**************************************************************************/
+	bool getBatteryMillivolts(uint16_t *mv);
+
+  /**************************************************************************/
+  /*!
+    @brief    Get the voltage on the AUX input.
+    @param    mv  Pointer to variable to receive the voltage, millivolts.
+    @returns  true if successful, false if it has not yet been read.
+  */
+  /**************************************************************************/
+	bool getAuxMillivolts(uint16_t *mv);
+
+  /**************************************************************************/
+  /*!
+    @brief    Get the controller's temperature.
+    @param    tenthsC   Pointer to variable to receive the temperature, in
+                        tenths of a degree C.
+    @returns  true if successful, false if TEMP0 and TEMP1 have not both been
+              read.
+    @note     The temperature is found from the difference between the TEMP1
+              and TEMP0 readings, which needs no calibration, with the
+              formula of the XPT2046 data sheet. One count of difference is
+              about 1.6 degrees C.
+  */
+  /**************************************************************************/
+	bool getTemperature(int16_t *tenthsC);
+
+  /**************************************************************************/
+  /*!
+    @brief    Select 8-bit or 12-bit conversions (the controller's MODE bit).
+    @param    enable  true for 8-bit conversions, false for 12-bit (default).
+    @note     8-bit conversions complete faster, so together with a higher SPI
+              clock given to begin() they raise the achievable sample rate, at
+              the cost of resolution. Coordinates and pressure keep the same
+              0-4095 range, in steps of 16.
+  */
+  /**************************************************************************/
+	void set8BitMode(bool enable);
+
+  /**************************************************************************/
+  /*!
+    @brief    Return flag indicating if 8-bit conversions are selected.
+    @returns  true if 8-bit conversions are selected, false if 12-bit.
+  */
+  /**************************************************************************/
+	bool is8BitMode() { return(_mode != 0); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Set the filter and number of X/Y readings per sample.
+    @param    filter    The filter that reduces the readings of each coordinate
+                        to one value (see TS_Filter.h). Default is
+                        TS_FILTER_BEST_TWO_AVG.
+    @param    samples   Number of X/Y readings per sample, 1 to
+                        XPT2046_MAX_SAMPLES. Default is XPT2046_DEF_SAMPLES (3).
+    @note     More readings take more SPI time per sample but reject noise
+              spikes better. TS_FILTER_RANSAC also rejects whole samples whose
+              readings don't agree, so that noise doesn't cause bogus touches.
+  */
+  /**************************************************************************/
+	void setFilter(eTS_Filter filter, uint8_t samples = XPT2046_DEF_SAMPLES);
+
+  /**************************************************************************/
+  /*!
+    @brief    Get the filter set by setFilter().
+    @returns  The filter that reduces the readings of each coordinate.
+  */
+  /**************************************************************************/
+	eTS_Filter filter() { return(_filter); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Get the number of X/Y readings per sample set by setFilter().
+    @returns  Number of X/Y readings per sample.
+  */
+  /**************************************************************************/
+	uint8_t filterSamples() { return(_samples); }
+
   /**************************************************************************/
   /*!
     @brief    Get z-threshold for recognizing a press.
@@ -337,6 +1170,461 @@ public:
   /**************************************************************************/
 	void set_isrWake(bool value) { isrWake = value; }
 
+  /**************************************************************************/
+  /*!
+    @brief    Return an instance that uses an IRQ pin, by dispatch table slot.
+    @param    slot  Slot number, 0 to XPT2046_MAX_INSTANCES-1, as returned by
+                    isrSlot().
+    @returns  Pointer to the instance in that slot, nullptr if none.
+  */
+  /**************************************************************************/
+	static XPT2046_Touchscreen *instance(uint8_t slot);
+
+  /**************************************************************************/
+  /*!
+    @brief    Return this instance's slot in the IRQ dispatch table.
+    @returns  Slot number, or 255 if this instance does not use an IRQ pin or
+              begin() has not been called.
+  */
+  /**************************************************************************/
+	uint8_t isrSlot() { return (_isrSlot); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Return a bitmask of the instances whose tirqTouched() flag is set.
+    @returns  Bit i is set if the instance in slot i has its flag set.
+    @note     This makes no SPI calls, so it is a cheap way to find which of
+              several panels need to be read.
+  */
+  /**************************************************************************/
+	static uint8_t touchedMask();
+
+  /**************************************************************************/
+  /*!
+    @brief    Call a function for each instance whose tirqTouched() flag is
+              set, so that only panels actually being touched are read.
+    @param    service   Function to call, with a pointer to the instance.
+    @returns  Number of instances serviced.
+  */
+  /**************************************************************************/
+	static uint8_t serviceTouched(void (*service)(XPT2046_Touchscreen *ts));
+
+  /**************************************************************************/
+  /*!
+    @brief    Attach a T_IRQ falling edge interrupt that sets a flag, for
+              objects other than XPT2046_Touchscreen (e.g. XPT2046_TouchscreenT)
+              that need a wake flag but cannot supply an interrupt handler of
+              their own, since GCC drops IRAM_ATTR from template members.
+    @param    pin     Arduino pin number of the pin connected to T_IRQ.
+    @param    flag    Flag set true by the interrupt.
+    @returns  true if successful, false if XPT2046_MAX_INSTANCES flags are
+              already attached.
+    @note     Attaching the same flag again reuses its slot.
+  */
+  /**************************************************************************/
+	static bool attachWakeFlag(uint8_t pin, volatile bool *flag);
+
+  /**************************************************************************/
+  /*!
+    @brief    Attach a queue that receives every sample the driver produces.
+    @param    queue   Pointer to the queue (normally a TS_SampleRing declared
+                      by the application), or nullptr to detach the queue.
+    @note     Each touched sample is pushed with its micros() time, followed by
+              one sample with z=0 when the touch ends, so no samples are lost
+              between calls by the application. Include TS_SampleRing.h to
+              declare the queue.
+  */
+  /**************************************************************************/
+	void attachSampleQueue(TS_SampleQueue *queue);
+
+  /**************************************************************************/
+  /*!
+    @brief    Return the attached sample queue.
+    @returns  The queue attached with attachSampleQueue(), nullptr if none.
+  */
+  /**************************************************************************/
+	TS_SampleQueue *sampleQueue() { return (_queue); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Remove up to max samples from the attached sample queue.
+    @param    out   Array to receive the samples, oldest first.
+    @param    max   Maximum number of samples to remove.
+    @returns  Number of samples stored in out, 0 if no queue is attached.
+    @note     Samples are only produced when update() runs (or in event-driven
+              or asynchronous mode, in the background), so in polled mode this
+              calls update() first.
+  */
+  /**************************************************************************/
+	size_t readSamples(TS_Sample *out, size_t max);
+
+  /**************************************************************************/
+  /*!
+    @brief    Return number of samples dropped because the attached sample
+              queue was full.
+    @returns  Overflow count, 0 if no queue is attached.
+  */
+  /**************************************************************************/
+	uint32_t sampleOverflows();
+
+  /**************************************************************************/
+  /*!
+    @brief    Attach a recorder that receives the raw readings of every sample
+              the driver reads, for diagnosing touchscreen problems.
+    @param    recorder  Pointer to the recorder (normally an
+                        XPT2046_TraceBuffer declared by the application), or
+                        nullptr to detach the recorder.
+    @note     Z1, Z2, and the X/Y readings are recorded before the thresholds,
+              filter, and rotation are applied, with the micros() time of the
+              sample, whether or not the screen is touched. Include
+              XPT2046_Trace.h to declare the recorder.
+  */
+  /**************************************************************************/
+	void attachRecorder(XPT2046_TraceRecorder *recorder) { _recorder = recorder; }
+
+  /**************************************************************************/
+  /*!
+    @brief    Return the attached recorder.
+    @returns  The recorder attached with attachRecorder(), nullptr if none.
+  */
+  /**************************************************************************/
+	XPT2046_TraceRecorder *recorder() { return (_recorder); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Process a recorded sample as if it had just been read from the
+              controller, applying the current thresholds, filter, and
+              rotation and updating the touched point, sample queue, and
+              statistics.
+    @param    s   The sample, normally decoded by XPT2046_TraceReader.
+    @note     Use a touchscreen object whose begin() was not called, so that
+              getPoint() and TS_Display return the replayed samples instead of
+              reading the controller. A sample recorded without X/Y readings
+              that the current thresholds take as touched gets X/Y readings
+              of 0.
+  */
+  /**************************************************************************/
+	void replaySample(const XPT2046_TraceSample &s);
+
+  /**************************************************************************/
+  /*!
+    @brief    Set the functions used to start and stop the hardware timer that
+              clocks samples in event-driven mode.
+    @param    start   Function that starts a periodic timer interrupt every
+                      intervalUs microseconds. The timer interrupt handler must
+                      call sampleTimerTick() on this object.
+    @param    stop    Function that stops the periodic timer interrupt.
+    @note     On Teensy an IntervalTimer (one per instance) is used if this is
+              not called. On other platforms this must be called before
+              beginEventDriven().
+  */
+  /**************************************************************************/
+	void attachSampleTimer(void (*start)(uint32_t intervalUs), void (*stop)(void));
+
+  /**************************************************************************/
+  /*!
+    @brief    Start event-driven sampling. A T_IRQ falling edge starts the
+              sample timer, each timer tick reads one sample, and the timer is
+              stopped again when the touch pressure falls below
+              Z_Threshold_Int. No SPI activity occurs between touches, and the
+              application only consumes finished samples.
+    @param    intervalUs  Sample interval in microseconds while touched.
+    @returns  true if successful, false if no T_IRQ pin was given to the
+              constructor, begin() has not been called, no sample timer is
+              available, or threaded or step mode is in effect.
+    @note     While in event-driven mode, getPoint(), touched(), and readData()
+              never access the SPI bus. They return the most recent sample.
+    @note     Samples are read from the timer interrupt, so other users of the
+              same SPI bus must use SPI transactions and tell the SPI library
+              about the timer interrupt with SPI.usingInterrupt().
+    @note     Asynchronous mode, if enabled, is disabled.
+  */
+  /**************************************************************************/
+	bool beginEventDriven(uint32_t intervalUs = XPT2046_EVENT_INTERVAL_US);
+
+  /**************************************************************************/
+  /*!
+    @brief    Stop event-driven sampling and return to sampling from update().
+  */
+  /**************************************************************************/
+	void endEventDriven();
+
+  /**************************************************************************/
+  /*!
+    @brief    Return flag indicating if event-driven sampling is in effect.
+    @returns  true if in event-driven mode, else false.
+  */
+  /**************************************************************************/
+	bool eventDriven() { return (_eventDriven); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Return flag indicating if event-driven, threaded, or step mode
+              has completed a touched sample that has not yet been returned
+              by getPoint() or readData().
+    @returns  true if a new sample is available, else false.
+  */
+  /**************************************************************************/
+	bool sampleAvailable();
+
+  #if defined(XPT2046_HAS_THREADS)
+  /**************************************************************************/
+  /*!
+    @brief    Start threaded mode, in which sampling is done by serviceTask()
+              called repeatedly from a task or core other than the one using
+              the touchscreen, such as loop1() on RP2040 or a FreeRTOS task.
+              beginTask() does this on ESP32.
+    @returns  true if successful, false if begin() has not been called or
+              event-driven or step mode is in effect.
+    @note     While in threaded mode, getPoint(), touched(), and readData()
+              never access the SPI bus or block. They return a snapshot of the
+              most recent sample, published without locks so a reader never
+              waits for the sampling task.
+    @note     Settings (filter, thresholds, rotation, sample interval, and so
+              on) should be changed only before this is called or after
+              endThreaded(). A sample queue attached with attachSampleQueue()
+              is single producer/single consumer, so it may be filled by the
+              sampling task and drained by the application.
+    @note     The SPI bus must not be used by another core at the same time.
+              The ESP32 SPI driver serializes transactions of both cores; on
+              RP2040 put the display on the other SPI port or draw from the
+              sampling core.
+    @note     Asynchronous mode, if enabled, is disabled.
+  */
+  /**************************************************************************/
+	bool beginThreaded();
+
+  /**************************************************************************/
+  /*!
+    @brief    Stop threaded mode (and the sampling task, if started with
+              beginTask()) and return to sampling from update(). serviceTask()
+              must no longer be called.
+  */
+  /**************************************************************************/
+	void endThreaded();
+
+  /**************************************************************************/
+  /*!
+    @brief    Return flag indicating if threaded mode is in effect.
+    @returns  true if in threaded mode, else false.
+  */
+  /**************************************************************************/
+	bool threaded() { return (_threaded); }
+
+  /**************************************************************************/
+  /*!
+    @brief    In threaded mode, read a sample if one is due and publish it for
+              getPoint(). Call this repeatedly from the sampling task or core,
+              not from the one using the touchscreen.
+    @note     While idle() is true nothing is read, so the task may block
+              until a wake handler (see attachWakeHandler()) signals a new
+              touch, or until the next auxiliary input conversion is due.
+  */
+  /**************************************************************************/
+	void serviceTask();
+
+  #if defined(XPT2046_HAS_TASK)
+  /**************************************************************************/
+  /*!
+    @brief    Start threaded mode with sampling done by a FreeRTOS task that
+              calls serviceTask() every sample interval while touched, and
+              blocks between touches until T_IRQ falls (or an auxiliary input
+              conversion is due). ESP32 only.
+    @param    core      Core the task is pinned to, or -1 for any core.
+    @param    priority  FreeRTOS priority of the task.
+    @param    stack     Stack size of the task in bytes.
+    @returns  true if successful, false if beginThreaded() fails, the task is
+              already running, or the task could not be created.
+  */
+  /**************************************************************************/
+	bool beginTask(int8_t core = XPT2046_TASK_CORE,
+		uint8_t priority = XPT2046_TASK_PRIORITY,
+		uint32_t stack = XPT2046_TASK_STACK);
+  #endif
+  #endif
+
+  #if XPT2046_STEP_MODE
+  /**************************************************************************/
+  /*!
+    @brief    Enable or disable step mode, in which each sample is read in
+              small steps of bounded time by repeated calls to poll(), so that
+              touchscreen sampling can be interleaved with hard real-time work
+              in the same loop.
+    @param    enable  true to sample from poll(), false to return to sampling
+                      from update().
+    @returns  true if the requested mode is now in effect, false if step mode
+              was requested before begin() was called or while in event-driven
+              or threaded mode.
+    @note     While in step mode, getPoint(), touched(), and readData() never
+              access the SPI bus. They return the most recent sample.
+    @note     Disabling step mode first finishes the sample being read, so the
+              controller is left powered down.
+    @note     Asynchronous mode, if enabled, is disabled.
+    @note     Only available when XPT2046_STEP_MODE is 1.
+  */
+  /**************************************************************************/
+	bool setStepMode(bool enable);
+
+  /**************************************************************************/
+  /*!
+    @brief    Return flag indicating if step mode is in effect.
+    @returns  true if in step mode, else false.
+  */
+  /**************************************************************************/
+	bool stepMode() { return (_stepMode); }
+
+  /**************************************************************************/
+  /*!
+    @brief    In step mode, do the next step of reading a sample: one
+              controller conversion, or, once all conversions of the sample
+              are done, filtering and storing it. A new sample is started when
+              update() would read one. Call this repeatedly, e.g. once per pass
+              of loop().
+    @returns  true if this call completed a sample, else false.
+    @note     A conversion step is one SPI transaction of 3 bytes: 24 SPI
+              clocks (12 us at the default 2 MHz clock) plus the transaction
+              and CS overhead, about 25 us on a 16 MHz AVR and less on faster
+              boards. With XPT2046_STATS, each step is counted as one
+              transaction, so csMaxUs is the longest conversion step.
+    @note     The processing step takes the time of the filter
+              (TS_FILTER_RANSAC with many readings is the slowest) and of any
+              attached sample queue or recorder, but no SPI transfer.
+    @note     A touched sample takes 3 + 2n conversion steps, n being the
+              number of X/Y readings (3 by default), and an untouched one 3,
+              or 5 when it reads an auxiliary input, each followed by the
+              processing step. When no sample is due, poll() returns after a
+              micros() call.
+  */
+  /**************************************************************************/
+	bool poll();
+  #endif
+
+  /**************************************************************************/
+  /*!
+    @brief    Read one sample in event-driven mode. Called from the sample timer
+              interrupt, not by user code.
+  */
+  /**************************************************************************/
+	void sampleTimerTick();
+
+  /**************************************************************************/
+  /*!
+    @brief    Handle a T_IRQ falling edge. Called by the touch interrupt
+              handler, not by user code.
+  */
+  /**************************************************************************/
+	void tirqInterrupt();
+
+  /**************************************************************************/
+  /*!
+    @brief    Return flag indicating if the touchscreen is idle: not touched,
+              with the controller's ADC powered down by the last command and
+              only its pen interrupt enabled, and the SPI bus not in use by
+              this object.
+    @returns  true if idle, false if touched, if a touch may be in progress,
+              or if no IRQ pin was given to the constructor.
+    @note     While idle, getPoint(), touched(), and readData() do not access
+              the SPI bus, so it is free for other devices until the next
+              touch.
+  */
+  /**************************************************************************/
+	bool idle();
+
+  /**************************************************************************/
+  /*!
+    @brief    Set a function to be called when a touch ends idle.
+    @param    handler   Function called from the T_IRQ interrupt on the first
+                        falling edge after becoming idle, with a pointer to
+                        this object, or nullptr for none.
+    @note     The handler runs in interrupt context, so it should only set
+              flags or undo sleep-related settings (e.g. restore clocks).
+  */
+  /**************************************************************************/
+	void attachWakeHandler(void (*handler)(XPT2046_Touchscreen *ts)) {
+	  _wakeHandler = handler;
+	}
+
+  /**************************************************************************/
+  /*!
+    @brief    Wait in low-power sleep until the screen is touched.
+    @param    sleep   Function that puts the MCU to sleep until an interrupt
+                      occurs. It is called with interrupts disabled and must
+                      enable them and sleep as one atomic step, e.g. on AVR
+                      "sleep_enable(); sei(); sleep_cpu(); sleep_disable();", or
+                      on ARM "__WFI(); interrupts();", so that a touch arriving
+                      just before it is called is not missed.
+    @returns  true when touched, false immediately if no IRQ pin was given to
+              the constructor or begin() failed (no wake-up is possible).
+    @note     A pending read is done first so that the controller is left
+              powered down. If a touch is already in progress, this returns
+              without sleeping. Other interrupts that wake the MCU simply put
+              it back to sleep.
+  */
+  /**************************************************************************/
+	bool sleepUntilTouch(void (*sleep)(void));
+
+  #if XPT2046_STATS
+  /**************************************************************************/
+  /*!
+    @brief    Get the driver statistics.
+    @param    stats   Pointer to variable to receive a copy of the statistics.
+    @note     Only available when XPT2046_STATS is 1.
+  */
+  /**************************************************************************/
+	void getStats(XPT2046_Stats *stats);
+
+  /**************************************************************************/
+  /*!
+    @brief    Reset the driver statistics to zero.
+    @note     Only available when XPT2046_STATS is 1.
+  */
+  /**************************************************************************/
+	void resetStats();
+  #endif
+
+  #if defined(XPT2046_HAS_ASYNC)
+  /**************************************************************************/
+  /*!
+    @brief    Enable or disable asynchronous (non-blocking) acquisition.
+    @param    enable  true to acquire samples in the background using a single
+                      DMA transfer per sample, false for normal blocking
+                      acquisition.
+    @returns  true if the requested mode is now in effect, false if
+              asynchronous mode was requested before begin() was called or
+              while in event-driven, threaded, or step mode.
+    @note     In asynchronous mode, getPoint(), touched(), and readData() never
+              wait for the SPI bus. Each call starts a new acquisition if one is
+              due and none is in flight, and returns the last completed sample.
+              The Z1/Z2/X/Y command sequence is sent as one prebuilt buffer, and
+              filtering and rotation run when the transfer completes.
+    @note     Because the whole command sequence is always sent, an
+              asynchronous acquisition does not stop early when the pressure
+              is below Z_Threshold as blocking acquisition does.
+    @note     On Teensy the completion handler runs from the DMA interrupt. On
+              Adafruit SAMD cores, completion is detected by the next call to
+              getPoint(), touched(), or readData().
+    @note     Only available when XPT2046_HAS_ASYNC is defined.
+  */
+  /**************************************************************************/
+	bool setAsyncMode(bool enable);
+
+  /**************************************************************************/
+  /*!
+    @brief    Return flag indicating if asynchronous acquisition is enabled.
+    @returns  true if asynchronous acquisition is enabled, else false.
+  */
+  /**************************************************************************/
+	bool asyncMode() { return (_asyncMode); }
+
+  /**************************************************************************/
+  /*!
+    @brief    Complete the asynchronous frame in flight. Called by the DMA
+              completion handler, not by user code.
+  */
+  /**************************************************************************/
+	void asyncComplete();
+  #endif
+
 };
 
 #ifndef ISR_PREFIX
@@ -0,0 +1,108 @@
+/*
+  XPT2046_Trace.cpp - Recording of raw touchscreen samples in a delta-encoded
+  binary ring buffer, and decoding of the recording for replay.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Arduino.h>
+#include <XPT2046_Trace.h>
+
+static_assert(XPT2046_MAX_SAMPLES <= 15,
+  "XPT2046_MAX_SAMPLES must fit in the 4-bit record count");
+
+/**************************************************************************/
+bool XPT2046_TraceRecorder::record(int16_t z1, int16_t z2, const int16_t* xs,
+    const int16_t* ys, uint8_t n, uint32_t us) {
+  uint8_t rec[XPT2046_TRACE_MAX_RECORD];
+  uint8_t* p = rec;
+  bool key = _key;
+  int16_t x = key ? 0 : _x;
+  int16_t y = key ? 0 : _y;
+  *p++ = n | (key ? XPT2046_TRACE_KEY : 0);
+  p = TS_putVarint(p, us - (key ? 0 : _us));
+  p = TS_putZigzag(p, z1 - (key ? 0 : _z1));
+  p = TS_putZigzag(p, z2 - (key ? 0 : _z2));
+  for (uint8_t i = 0; i < n; i++) {
+    p = TS_putZigzag(p, xs[i] - x);
+    x = xs[i];
+    p = TS_putZigzag(p, ys[i] - y);
+    y = ys[i];
+  }
+  if (!put(rec, (size_t)(p - rec))) {
+    _overflows = _overflows + 1;
+    _key = true;
+    return(false);
+  }
+  _us = us;
+  _z1 = z1;
+  _z2 = z2;
+  _x = x;
+  _y = y;
+  _key = false;
+  return(true);
+}
+
+/**************************************************************************/
+bool XPT2046_TraceReader::next(XPT2046_TraceSample* s) {
+  size_t start = _pos;
+  if (_pos >= _len)
+    return(false);
+  uint8_t h = _data[_pos++];
+  uint8_t n = h & 0x0F;
+  bool key = (h & XPT2046_TRACE_KEY) != 0;
+  uint32_t dt;
+  int16_t z1 = key ? 0 : _z1;
+  int16_t z2 = key ? 0 : _z2;
+  int16_t x = key ? 0 : _x;
+  int16_t y = key ? 0 : _y;
+  bool ok = (h & 0xE0) == 0 && n <= XPT2046_MAX_SAMPLES && getVarint(&dt) &&
+    getDelta(&z1) && getDelta(&z2);
+  for (uint8_t i = 0; ok && i < n; i++) {
+    ok = getDelta(&x) && getDelta(&y);
+    s->xs[i] = x;
+    s->ys[i] = y;
+  }
+  if (!ok) {
+    _pos = start;
+    return(false);
+  }
+  _us = (key ? 0 : _us) + dt;
+  _z1 = z1;
+  _z2 = z2;
+  _x = x;
+  _y = y;
+  s->us = _us;
+  s->z1 = z1;
+  s->z2 = z2;
+  s->n = n;
+  return(true);
+}
+
+// -------------------------------------------------------------------------
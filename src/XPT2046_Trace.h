@@ -0,0 +1,249 @@
+/*
+  XPT2046_Trace.h - Defines struct XPT2046_TraceSample, classes
+  XPT2046_TraceRecorder and XPT2046_TraceBuffer, which record the raw readings
+  of every touchscreen sample in a compact delta-encoded binary stream, and
+  class XPT2046_TraceReader, which decodes the stream for replay.
+  Released into the public domain.
+
+
+  Software License Agreement (BSD License)
+
+  Copyright (c) 2023 Ted Toal
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  3. Neither the name of the copyright holders nor the
+  names of its contributors may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+  To see what the controller actually returned when a touchscreen misbehaves
+  in the field (ghost touches, jumps, missed releases), attach a trace
+  recorder to the touchscreen with attachRecorder(). Every sample the driver
+  reads, touched or not, is then appended to the recorder's ring buffer as the
+  raw pressure readings Z1 and Z2 and the raw X/Y readings, before filtering,
+  rotation, and thresholds are applied, with its micros() time. Each value is
+  stored as the difference from the previous one, so a typical sample takes
+  about a dozen bytes. Recording costs a few shifts per value and no
+  formatting, so it can be left running in the application.
+
+  The application streams the recording out in the background, as binary
+  bytes, with writeTo() (to Serial, an SD card File, or any other Print), and
+  the recording is decoded later with XPT2046_TraceReader. Each decoded sample
+  can be fed back through the driver's thresholds and filters with the
+  touchscreen's replaySample() function, and from there through TS_Display, so
+  a field problem can be reproduced and the fix checked offline.
+
+  Like TS_SampleRing, the buffer is a lock-free single-producer/single-consumer
+  ring. When it is full the new sample is dropped and counted, and the next
+  sample recorded is a key sample, encoded without reference to the previous
+  one, so decoding stays correct.
+
+  Stream format. Each sample is one record:
+
+    byte      Bits 0-3: number of X/Y reading pairs that follow (0 if the
+              pressure was too low for X/Y to be read). Bit 4: key record.
+              Bits 5-7: 0.
+    varint    micros() time minus that of the previous record (the time
+              itself in a key record).
+    zvarint   Z1 minus the previous Z1.
+    zvarint   Z2 minus the previous Z2.
+    zvarint   For each X/Y pair, X minus the previous X reading, then Y minus
+              the previous Y reading.
+
+  A varint is an unsigned value 7 bits per byte, least significant first, with
+  bit 7 set in all but the last byte. A zvarint is a signed value mapped to an
+  unsigned varint as 0, -1, 1, -2, ... (zigzag encoding). In a key record the
+  previous values are all 0. The first record is a key record.
+
+  Usage:
+
+    XPT2046_TraceBuffer<512> trace;
+    ...
+    ts->attachRecorder(&trace);
+    ...
+    trace.writeTo(Serial);    // in loop()
+
+  and to replay a recording:
+
+    XPT2046_TraceReader reader(data, len);
+    XPT2046_TraceSample s;
+    while (reader.next(&s))
+      ts->replaySample(s);
+*/
+/**************************************************************************/
+
+#ifndef XPT2046_Trace_h
+#define XPT2046_Trace_h
+
+#include <Arduino.h>
+#include <XPT2046_Touchscreen_TT.h>
+#include <TS_ByteRing.h>
+
+// Record flag marking a key record.
+#define XPT2046_TRACE_KEY   0x10
+
+// Largest number of bytes in one record.
+#define XPT2046_TRACE_MAX_RECORD  (1 + 5 + 3*(2 + 2*XPT2046_MAX_SAMPLES))
+
+/**************************************************************************/
+/*!
+  @brief    Struct XPT2046_TraceSample holds the raw readings of one recorded
+            sample: its micros() time, pressure readings z1 and z2, and n X/Y
+            reading pairs in controller coordinates (before rotation). n is 0
+            if the pressure was too low for X/Y to be read.
+*/
+/**************************************************************************/
+struct XPT2046_TraceSample {
+  uint32_t us;
+  int16_t z1, z2;
+  uint8_t n;
+  int16_t xs[XPT2046_MAX_SAMPLES];
+  int16_t ys[XPT2046_MAX_SAMPLES];
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class XPT2046_TraceRecorder encodes samples into a lock-free
+            single-producer/single-consumer ring buffer of bytes, from which
+            the recording is removed with the TS_ByteRing functions. It does
+            not own its storage; use class XPT2046_TraceBuffer to declare a
+            recorder with storage of a given size.
+*/
+/**************************************************************************/
+class XPT2046_TraceRecorder : public TS_ByteRing {
+
+protected:
+
+  // Previous values encoded, and true if the next record must be a key record.
+  uint32_t _us;
+  int16_t _z1, _z2, _x, _y;
+  bool _key;
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  buf       Storage for capacity bytes.
+    @param  capacity  Number of bytes in buf, a power of two.
+  */
+  /**************************************************************************/
+  XPT2046_TraceRecorder(uint8_t* buf, TS_RingIndex capacity) :
+      TS_ByteRing(buf, capacity), _us(0), _z1(0), _z2(0), _x(0), _y(0),
+      _key(true) {}
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Record one sample. Called only by the producer (the touchscreen
+            driver).
+    @param  z1    Pressure reading Z1.
+    @param  z2    Pressure reading Z2.
+    @param  xs    Array of n X readings.
+    @param  ys    Array of n Y readings.
+    @param  n     Number of X/Y reading pairs, 0 if X/Y were not read.
+    @param  us    micros() time the sample was read.
+    @returns  true if the sample was recorded, false if the buffer was full,
+              in which case the overflow counter is incremented.
+  */
+  /**************************************************************************/
+  bool record(int16_t z1, int16_t z2, const int16_t* xs, const int16_t* ys,
+    uint8_t n, uint32_t us);
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class XPT2046_TraceBuffer is an XPT2046_TraceRecorder with storage
+            for N bytes.
+  @param    N   Capacity, a power of two no larger than TS_RING_MAX_CAPACITY
+                and at least XPT2046_TRACE_MAX_RECORD.
+*/
+/**************************************************************************/
+template <size_t N>
+class XPT2046_TraceBuffer : public XPT2046_TraceRecorder {
+
+  static_assert((N & (N - 1)) == 0,
+    "XPT2046_TraceBuffer capacity must be a power of two");
+  static_assert(N >= XPT2046_TRACE_MAX_RECORD,
+    "XPT2046_TraceBuffer capacity is too small for one record");
+  static_assert(N <= TS_RING_MAX_CAPACITY,
+    "XPT2046_TraceBuffer capacity is too large for TS_RingIndex");
+
+private:
+
+  uint8_t _storage[N];
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+  */
+  /**************************************************************************/
+  XPT2046_TraceBuffer() : XPT2046_TraceRecorder(_storage, N) {}
+};
+
+/**************************************************************************/
+/*!
+  @brief    Class XPT2046_TraceReader decodes a recording made by
+            XPT2046_TraceRecorder, one sample at a time.
+*/
+/**************************************************************************/
+class XPT2046_TraceReader : public TS_VarintReader {
+
+private:
+
+  // Previous values decoded.
+  uint32_t _us;
+  int16_t _z1, _z2, _x, _y;
+
+public:
+
+  /**************************************************************************/
+  /*!
+    @brief  Constructor.
+    @param  data  The recording, starting at its first record, which must
+                  remain in existence while it is read.
+    @param  len   Number of bytes in data.
+  */
+  /**************************************************************************/
+  XPT2046_TraceReader(const uint8_t* data, size_t len) :
+      TS_VarintReader(data, len), _us(0), _z1(0), _z2(0), _x(0), _y(0) {}
+
+  /**************************************************************************/
+  /*!
+    @brief  Decode the next sample.
+    @param  s   Pointer to variable to receive the sample.
+    @returns  true if successful, false at the end of the recording or if the
+              next record is incomplete or invalid.
+  */
+  /**************************************************************************/
+  bool next(XPT2046_TraceSample* s);
+
+  /**************************************************************************/
+  /*!
+    @brief  Return the position of the next record.
+    @returns  Number of bytes of the recording decoded so far.
+  */
+  /**************************************************************************/
+  size_t position() { return(_pos); }
+};
+
+#endif // XPT2046_Trace_h